@@ -141,6 +141,7 @@
 #ifdef JENT_ARCH_MEM_POSIX_MLOCK
 # include <sys/mman.h>
 # include <errno.h>
+# include <pthread.h>	/* pthread_atfork() */
 # include <unistd.h>	/* sysconf() */
 #endif
 
@@ -268,6 +269,286 @@ static size_t jent_pagesize(void)
 
 	return (page_size <= 0) ? 4096 : (size_t)page_size;
 }
+
+/* The huge page JENT_HUGE_PAGES aligns to: 2 MB, the PMD size of 4 kB pages */
+# define JENT_HUGE_PAGE_SIZE	((size_t)1 << 21)
+
+/*
+ * Map the [guard page | payload | guard page] layout of jent_zalloc() for
+ * JENT_HUGE_PAGES: the payload starts on a huge page, and is backed by huge
+ * pages wherever the system can be talked into it.
+ *
+ * A reservation one huge page larger than the layout is trimmed at both ends,
+ * so the mapping left over is exactly the one jent_zfree() unmaps. On Linux,
+ * the payload is then replaced by a mapping of explicit huge pages, which
+ * exist only when the administrator reserved them (vm.nr_hugepages) and only
+ * for a whole number of them; failing that, transparent huge pages are
+ * requested, which the kernel provides as the zeroing pass faults the payload
+ * in. Where neither exists, the alignment alone is what the flag gets - which
+ * is what the superpage promotion of FreeBSD needs.
+ */
+static uint8_t *jent_map_huge(size_t payload, size_t page_size, int mmap_flags,
+			      int *prefaulted)
+{
+	size_t total = payload + 2 * page_size;
+	uint8_t *res, *base;
+	size_t head;
+
+	if (total > SIZE_MAX - JENT_HUGE_PAGE_SIZE)
+		return MAP_FAILED;
+
+	res = mmap(NULL, total + JENT_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		   mmap_flags, -1, 0);
+	if (res == MAP_FAILED)
+		return MAP_FAILED;
+
+	base = (uint8_t *)((((uintptr_t)res + page_size +
+			     JENT_HUGE_PAGE_SIZE - 1) &
+			    ~(uintptr_t)(JENT_HUGE_PAGE_SIZE - 1)) - page_size);
+	head = (size_t)(base - res);
+	if (head)
+		munmap(res, head);
+	munmap(base + total, JENT_HUGE_PAGE_SIZE - head);
+
+# ifdef MAP_HUGETLB
+	if (!(payload & (JENT_HUGE_PAGE_SIZE - 1))) {
+		int huge_flags = mmap_flags | MAP_FIXED | MAP_HUGETLB;
+
+#  ifdef MAP_POPULATE
+		huge_flags |= MAP_POPULATE;
+#  endif
+		if (mmap(base + page_size, payload, PROT_READ | PROT_WRITE,
+			 huge_flags, -1, 0) != MAP_FAILED) {
+#  ifdef MAP_POPULATE
+			*prefaulted = 1;
+#  endif
+			return base;
+		}
+
+		/*
+		 * A failed MAP_FIXED mapping may already have removed the one
+		 * it was to replace. The range is still this caller's, so
+		 * map it again either way.
+		 */
+		if (mmap(base + page_size, payload, PROT_READ | PROT_WRITE,
+			 mmap_flags | MAP_FIXED, -1, 0) == MAP_FAILED) {
+			munmap(base, total);
+			return MAP_FAILED;
+		}
+	}
+# endif
+
+	/* Best effort, as the mapping is usable without */
+# ifdef MADV_HUGEPAGE
+	madvise(base + page_size, payload, MADV_HUGEPAGE);
+# endif
+
+	return base;
+}
+
+/*
+ * Slab of small objects.
+ *
+ * A collector makes several small allocations - its rand_data, the hash
+ * state, the context of the internal timer - and each of them used to be a
+ * mapping of its own: an mmap(), two mprotect(), a madvise() and an mlock()
+ * for a few hundred bytes, which also locked a whole page. With hundreds of
+ * collectors that ran into RLIMIT_MEMLOCK long before the memory was used.
+ *
+ * Objects of up to JENT_SLAB_MAX_OBJECT bytes are therefore carved out of
+ * slabs of JENT_SLAB_SIZE bytes, in units of a cache line so that no two
+ * objects share one. A slab is an ordinary jent_zalloc() allocation demanding
+ * secure memory, so it is locked, excluded from core dumps and surrounded by
+ * guard pages; the objects within it are not separated by guard pages from
+ * each other. A slab that cannot be had locked leaves its objects to the
+ * mapping per object, which applies the usual rules for a refused lock.
+ *
+ * Only allocations demanding secure memory are served from a slab: for the
+ * others a refused lock is no error, and a slab would turn it into one for
+ * every object it holds. A refused slab is remembered in jent_slab_refused,
+ * so that each later allocation does not try and fail to lock 64 kB before
+ * falling back; it is tried again once a slab was unmapped and its share of
+ * RLIMIT_MEMLOCK returned. Nor is there a slab on a host with more than one
+ * NUMA node, where jent_memory_bind_node() has to be able to move the state
+ * and hash state of a collector, which it cannot do to pages shared with
+ * other collectors.
+ *
+ * A freed object is wiped before its units are released, so the free units of
+ * a slab are always zero, and a slab whose last object is freed is unmapped.
+ * The first units of a slab hold its header.
+ */
+# define JENT_SLAB_SIZE		(64 * 1024)
+# define JENT_SLAB_UNIT		64
+# define JENT_SLAB_UNITS	(JENT_SLAB_SIZE / JENT_SLAB_UNIT)
+# define JENT_SLAB_MAX_OBJECT	1024
+
+struct jent_slab {
+	struct jent_slab *next;
+	unsigned int used;		/* Units held by objects */
+	uint64_t map[JENT_SLAB_UNITS / 64]; /* Bit set: unit in use */
+};
+
+#define JENT_SLAB_HEADER_UNITS						      \
+	((sizeof(struct jent_slab) + JENT_SLAB_UNIT - 1) / JENT_SLAB_UNIT)
+
+static struct jent_slab *jent_slabs;
+
+/*
+ * The list is only held for a scan of a bitmap, never across a system call,
+ * which a spin on the one atomic exchange the library has serves well.
+ */
+static int jent_slabs_locked;
+
+/* Set when no locked slab could be mapped, see above */
+static int jent_slab_refused;
+
+static void jent_slab_lock(void)
+{
+	while (jent_atomic_exchange_int(&jent_slabs_locked, 1))
+		;
+}
+
+static void jent_slab_unlock(void)
+{
+	jent_atomic_store_int(&jent_slabs_locked, 0);
+}
+
+static int jent_slab_unit_used(const struct jent_slab *slab, unsigned int unit)
+{
+	return !!(slab->map[unit / 64] & (UINT64_C(1) << (unit % 64)));
+}
+
+static void jent_slab_mark(struct jent_slab *slab, unsigned int unit,
+			   unsigned int units, int used)
+{
+	unsigned int i;
+
+	for (i = unit; i < unit + units; i++) {
+		if (used)
+			slab->map[i / 64] |= UINT64_C(1) << (i % 64);
+		else
+			slab->map[i / 64] &= ~(UINT64_C(1) << (i % 64));
+	}
+}
+
+/* First fit: the index of the first run of @units free units, or -1 */
+static int jent_slab_find(const struct jent_slab *slab, unsigned int units)
+{
+	unsigned int i, run = 0;
+
+	for (i = JENT_SLAB_HEADER_UNITS; i < JENT_SLAB_UNITS; i++) {
+		if (jent_slab_unit_used(slab, i)) {
+			run = 0;
+			continue;
+		}
+		if (++run == units)
+			return (int)(i + 1 - units);
+	}
+
+	return -1;
+}
+
+static void *jent_slab_alloc(size_t len)
+{
+	unsigned int units = (unsigned int)((len + JENT_SLAB_UNIT - 1) /
+					    JENT_SLAB_UNIT);
+	struct jent_slab *slab, *fresh = NULL;
+	void *ret = NULL;
+	int unit;
+
+	if (!len || len > JENT_SLAB_MAX_OBJECT)
+		return NULL;
+	if (jent_atomic_load_int(&jent_slab_refused) ||
+	    jent_memory_nodes() > 1)
+		return NULL;
+
+	for (;;) {
+		jent_slab_lock();
+		if (fresh) {
+			fresh->next = jent_slabs;
+			jent_slabs = fresh;
+		}
+		for (slab = jent_slabs; slab; slab = slab->next) {
+			unit = jent_slab_find(slab, units);
+			if (unit < 0)
+				continue;
+
+			jent_slab_mark(slab, (unsigned int)unit, units, 1);
+			slab->used += units;
+			ret = (uint8_t *)slab + (size_t)unit * JENT_SLAB_UNIT;
+			break;
+		}
+		jent_slab_unlock();
+
+		/* A fresh slab always has room, so this runs at most twice */
+		if (ret || fresh)
+			return ret;
+
+		/* Mapped outside the lock; see jent_slabs_locked */
+		fresh = jent_zalloc(JENT_SLAB_SIZE, JENT_FORCE_SECURE_MEM);
+		if (!fresh) {
+			jent_atomic_store_int(&jent_slab_refused, 1);
+			return NULL;
+		}
+		jent_slab_mark(fresh, 0, JENT_SLAB_HEADER_UNITS, 1);
+	}
+}
+
+/* Whether @ptr lies in a slab */
+static int jent_slab_holds(const void *ptr)
+{
+	const struct jent_slab *slab;
+	uintptr_t addr = (uintptr_t)ptr;
+
+	jent_slab_lock();
+	for (slab = jent_slabs; slab; slab = slab->next) {
+		if (addr > (uintptr_t)slab &&
+		    addr < (uintptr_t)slab + JENT_SLAB_SIZE)
+			break;
+	}
+	jent_slab_unlock();
+
+	return slab != NULL;
+}
+
+/* Returns 1 when @ptr came from a slab and is released, 0 otherwise */
+static int jent_slab_free(void *ptr, size_t len)
+{
+	unsigned int units = (unsigned int)((len + JENT_SLAB_UNIT - 1) /
+					    JENT_SLAB_UNIT);
+	struct jent_slab *slab, **prev, *empty = NULL;
+	uintptr_t addr = (uintptr_t)ptr;
+
+	if (!len || len > JENT_SLAB_MAX_OBJECT)
+		return 0;
+
+	jent_slab_lock();
+	for (prev = &jent_slabs; (slab = *prev) != NULL; prev = &slab->next) {
+		if (addr > (uintptr_t)slab &&
+		    addr < (uintptr_t)slab + JENT_SLAB_SIZE)
+			break;
+	}
+	if (slab) {
+		jent_memset_secure(ptr, (size_t)units * JENT_SLAB_UNIT);
+		jent_slab_mark(slab,
+			       (unsigned int)((addr - (uintptr_t)slab) /
+					      JENT_SLAB_UNIT),
+			       units, 0);
+		slab->used -= units;
+		if (!slab->used) {
+			*prev = slab->next;
+			empty = slab;
+		}
+	}
+	jent_slab_unlock();
+
+	if (empty) {
+		jent_zfree(empty, JENT_SLAB_SIZE);
+		jent_atomic_store_int(&jent_slab_refused, 0);
+	}
+
+	return slab != NULL;
+}
 #endif /* JENT_ARCH_MEM_POSIX_MLOCK */
 
 #ifdef JENT_ARCH_MEM_LINUX_KERNEL
@@ -288,11 +569,18 @@ void jent_zfree(void *ptr, size_t len)
 	kvfree_sensitive(ptr, len);
 }
 
+void jent_free_nonsensitive(void *ptr, size_t len)
+{
+	(void)len;
+	kvfree(ptr);
+}
+
 #else /* !JENT_ARCH_MEM_LINUX_KERNEL */
 
 void *jent_zalloc(size_t len, unsigned int flags)
 {
 	void *tmp = NULL;
+	int prefaulted = 0;
 
 #ifndef JENT_MEM_SECURE_ON_REQUEST
 	/* Only a backend that can be denied secure memory reads the flag. */
@@ -431,7 +719,9 @@ void *jent_zalloc(size_t len, unsigned int flags)
 
 #elif defined(JENT_ARCH_MEM_POSIX_MLOCK)
 
-	{
+	/* Small secure objects share the pages of a slab, see jent_slab_alloc() */
+	tmp = (flags & JENT_FORCE_SECURE_MEM) ? jent_slab_alloc(len) : NULL;
+	if (!tmp) {
 		/*
 		 * Layout: [guard page | payload (page-rounded) | guard page]
 		 *
@@ -480,8 +770,29 @@ void *jent_zalloc(size_t len, unsigned int flags)
 		payload = (len + page_size - 1) & ~(page_size - 1);
 		total = payload + 2 * page_size;
 
-		base = mmap(NULL, total, PROT_READ | PROT_WRITE, mmap_flags,
-			    -1, 0);
+		/* Only an allocation filling a huge page is worth one */
+		if ((flags & JENT_HUGE_PAGES) && len >= JENT_HUGE_PAGE_SIZE) {
+			base = jent_map_huge(payload, page_size, mmap_flags,
+					     &prefaulted);
+		} else {
+			/*
+			 * Fault the whole region in within mmap() rather than
+			 * one page at a time: a memory region of hundreds of
+			 * MB otherwise takes a trap per page, either in the
+			 * zeroing pass below or, with that pass gone, in the
+			 * first rounds of the noise source, where the fault
+			 * time would show in the startup deltas. The kernel
+			 * hands out the pages zeroed, so the zeroing pass is
+			 * skipped; where the flag does not exist, that pass
+			 * remains the prefault.
+			 */
+# ifdef MAP_POPULATE
+			mmap_flags |= MAP_POPULATE;
+			prefaulted = 1;
+# endif
+			base = mmap(NULL, total, PROT_READ | PROT_WRITE,
+				    mmap_flags, -1, 0);
+		}
 		if (base == MAP_FAILED)
 			return NULL;
 
@@ -552,7 +863,7 @@ void *jent_zalloc(size_t len, unsigned int flags)
 
 #endif
 
-	if (tmp != NULL)
+	if (tmp != NULL && !prefaulted)
 		jent_memset_secure(tmp, len);
 	return tmp;
 }
@@ -625,7 +936,7 @@ void jent_zfree(void *ptr, size_t len)
 
 #elif defined(JENT_ARCH_MEM_POSIX_MLOCK)
 
-	{
+	if (!jent_slab_free(ptr, len)) {
 		/*
 		 * Mirror the guard-page layout of jent_zalloc(): the mapping
 		 * starts one page before the returned pointer and covers the
@@ -654,4 +965,314 @@ void jent_zfree(void *ptr, size_t len)
 #endif
 }
 
+void jent_free_nonsensitive(void *ptr, size_t len)
+{
+	if (!ptr)
+		return;
+
+#ifdef LIBGCRYPT
+
+	/* The secmem pool wipes what it takes back, ordinary memory is not */
+	(void)len;
+	gcry_free(ptr);
+
+#elif defined(AWSLC)
+
+	/* OPENSSL_free() wipes unconditionally */
+	(void)len;
+	OPENSSL_free(ptr);
+
+#elif defined(OPENSSL)
+
+	(void)len;
+	OPENSSL_secure_free(ptr);
+
+#elif defined(JENT_ARCH_MEM_WINDOWS)
+
+	{
+		size_t page_size = jent_pagesize();
+		size_t payload = (len + page_size - 1) & ~(page_size - 1);
+		uint8_t *base = (uint8_t *)ptr - page_size;
+
+		VirtualUnlock(ptr, payload);
+		VirtualFree(base, 0, MEM_RELEASE);
+	}
+
+#elif defined(JENT_ARCH_MEM_POSIX_MLOCK)
+
+	/* A slab object shares its pages, wiping it costs nothing */
+	if (!jent_slab_free(ptr, len)) {
+		size_t page_size = jent_pagesize();
+		size_t payload = (len + page_size - 1) & ~(page_size - 1);
+
+		/*
+		 * The kernel hands out the pages zeroed to whoever maps them
+		 * next, so the mapping can go as it is.
+		 */
+		munmap((uint8_t *)ptr - page_size, payload + 2 * page_size);
+	}
+
+#else
+
+	(void)len;
+	free(ptr);
+
+#endif
+}
+
 #endif /* JENT_ARCH_MEM_LINUX_KERNEL */
+
+/*
+ * NUMA placement.
+ *
+ * Only Linux user space offers it here, through the raw mbind(),
+ * get_mempolicy() and getcpu() system calls rather than libnuma, which would
+ * be a new dependency for three calls. The constants are those of
+ * <linux/mempolicy.h>, which is not installed everywhere <sys/syscall.h> is.
+ */
+#if defined(__linux__) && !defined(LINUX_KERNEL)
+
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy) && defined(SYS_getcpu)
+
+#define JENT_MPOL_BIND		2
+#define JENT_MPOL_MF_MOVE	(1 << 1)
+#define JENT_MPOL_F_NODE	(1 << 0)
+#define JENT_MPOL_F_ADDR	(1 << 1)
+#define JENT_MPOL_F_MEMS_ALLOWED (1 << 2)
+
+/* Nodes the node mask of jent_memory_bind_node() can name */
+#define JENT_NUMA_MAX_NODES	(sizeof(unsigned long) * 8)
+
+int jent_memory_bind_node(void *ptr, size_t len, int node)
+{
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	uintptr_t start, end;
+	unsigned long nodemask;
+
+	if (!ptr || node < 0 || (size_t)node >= JENT_NUMA_MAX_NODES)
+		return -EINVAL;
+
+	/*
+	 * mbind() takes whole pages. Only the pages entirely inside the
+	 * allocation are bound, so that a neighbour sharing a page with it -
+	 * possible with the backends not allocating in pages - is not moved.
+	 */
+	start = ((uintptr_t)ptr + page_size - 1) & ~(uintptr_t)(page_size - 1);
+	end = ((uintptr_t)ptr + len) & ~(uintptr_t)(page_size - 1);
+	if (end <= start)
+		return 0;
+
+	/*
+	 * The kernel reads maxnode - 1 bits of the mask, so it takes one more
+	 * than the mask holds for the highest node to be named.
+	 */
+	nodemask = 1UL << node;
+	if (syscall(SYS_mbind, (void *)start, end - start, JENT_MPOL_BIND,
+		    &nodemask, JENT_NUMA_MAX_NODES + 1, JENT_MPOL_MF_MOVE))
+		return errno == ENOSYS ? -EOPNOTSUPP : -errno;
+
+	return 0;
+}
+
+int jent_memory_node(const void *ptr)
+{
+	int node = -1;
+
+	if (!ptr)
+		return -1;
+
+	if (syscall(SYS_get_mempolicy, &node, NULL, 0, ptr,
+		    JENT_MPOL_F_NODE | JENT_MPOL_F_ADDR))
+		return -1;
+
+	return node;
+}
+
+int jent_memory_nodes(void)
+{
+	static int nodes;
+	unsigned long nodemask = 0;
+	int ret = jent_atomic_load_int(&nodes);
+
+	if (ret)
+		return ret;
+
+	/*
+	 * A host with more nodes than the mask can name fails the query, and
+	 * counts as having several. The value is the same for every caller,
+	 * so a race merely has two of them ask.
+	 */
+	if (syscall(SYS_get_mempolicy, NULL, &nodemask, JENT_NUMA_MAX_NODES + 1,
+		    NULL, JENT_MPOL_F_MEMS_ALLOWED))
+		ret = errno == ENOSYS ? 1 : 2;
+	else
+		ret = (nodemask & (nodemask - 1)) ? 2 : 1;
+
+	jent_atomic_store_int(&nodes, ret);
+
+	return ret;
+}
+
+int jent_memory_local_node(void)
+{
+	unsigned int cpu = 0, node = 0;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL))
+		return -1;
+
+	return (int)node;
+}
+
+#define JENT_ARCH_MEM_NUMA
+#endif /* SYS_mbind && SYS_get_mempolicy && SYS_getcpu */
+
+#endif /* __linux__ && !LINUX_KERNEL */
+
+#ifndef JENT_ARCH_MEM_NUMA
+
+int jent_memory_bind_node(void *ptr, size_t len, int node)
+{
+	(void)ptr;
+	(void)len;
+	(void)node;
+
+	return -EOPNOTSUPP;
+}
+
+int jent_memory_node(const void *ptr)
+{
+	(void)ptr;
+
+	return -1;
+}
+
+int jent_memory_nodes(void)
+{
+	return 1;
+}
+
+int jent_memory_local_node(void)
+{
+	return -1;
+}
+
+#endif /* JENT_ARCH_MEM_NUMA */
+
+int jent_memory_bind_alloc(void *ptr, size_t len, int node)
+{
+#ifdef JENT_ARCH_MEM_POSIX_MLOCK
+	/*
+	 * Outside a slab the allocation is a mapping of its own starting on a
+	 * page, and the rest of its last page belongs to nobody else.
+	 */
+	if (ptr && !jent_slab_holds(ptr))
+		len = (len + jent_pagesize() - 1) & ~(jent_pagesize() - 1);
+#endif
+
+	return jent_memory_bind_node(ptr, len, node);
+}
+
+#ifdef JENT_ARCH_MEM_POSIX_MLOCK
+
+/*
+ * Fork generation: bumped by a child handler of pthread_atfork(), which runs
+ * in the child before fork() returns there, with the forking thread the only
+ * one alive - the plain increment needs no atomic. The handlers are registered
+ * by the first query, which the allocation of the first collector makes, so
+ * every collector compares against a counter that counts.
+ *
+ * fork() copies the spin locks of the library as they are. One held by another
+ * thread at that moment would stay held in the child, whose next allocation
+ * or shared region would spin forever. The prepare handler therefore takes
+ * jent_fork_lock and then every lock in jent_fork_guards - the slab list and
+ * whatever jent_fork_guard() added - and the parent and child handlers release
+ * them again. None of them is held across a call that could take another.
+ */
+#define JENT_FORK_GUARDS	4
+
+static uint32_t jent_fork_gen;
+static int jent_fork_registered;
+static int jent_fork_lock;
+static int *jent_fork_guards[JENT_FORK_GUARDS] = { &jent_slabs_locked };
+static unsigned int jent_fork_nguards = 1;
+
+static void jent_fork_prepare(void)
+{
+	unsigned int i;
+
+	while (jent_atomic_exchange_int(&jent_fork_lock, 1))
+		;
+	for (i = 0; i < jent_fork_nguards; i++) {
+		while (jent_atomic_exchange_int(jent_fork_guards[i], 1))
+			;
+	}
+}
+
+static void jent_fork_parent(void)
+{
+	unsigned int i = jent_fork_nguards;
+
+	while (i--)
+		jent_atomic_store_int(jent_fork_guards[i], 0);
+	jent_atomic_store_int(&jent_fork_lock, 0);
+}
+
+static void jent_fork_child(void)
+{
+	jent_fork_gen++;
+	jent_fork_parent();
+}
+
+uint32_t jent_fork_generation(void)
+{
+	if (!jent_atomic_load_int(&jent_fork_registered)) {
+		while (jent_atomic_exchange_int(&jent_fork_lock, 1))
+			;
+		if (!jent_fork_registered &&
+		    !pthread_atfork(jent_fork_prepare, jent_fork_parent,
+				    jent_fork_child))
+			jent_atomic_store_int(&jent_fork_registered, 1);
+		jent_atomic_store_int(&jent_fork_lock, 0);
+	}
+
+	return jent_atomic_load_u32(&jent_fork_gen);
+}
+
+void jent_fork_guard(int *lock)
+{
+	unsigned int i;
+
+	jent_fork_generation();
+
+	while (jent_atomic_exchange_int(&jent_fork_lock, 1))
+		;
+	for (i = 0; i < jent_fork_nguards; i++) {
+		if (jent_fork_guards[i] == lock)
+			break;
+	}
+	if (i == jent_fork_nguards && i < JENT_FORK_GUARDS)
+		jent_fork_guards[jent_fork_nguards++] = lock;
+	jent_atomic_store_int(&jent_fork_lock, 0);
+}
+
+#define JENT_ARCH_MEM_FORK
+#endif /* JENT_ARCH_MEM_POSIX_MLOCK */
+
+#ifndef JENT_ARCH_MEM_FORK
+
+/* Nothing forks: the kernel, Windows and bare metal */
+uint32_t jent_fork_generation(void)
+{
+	return 0;
+}
+
+void jent_fork_guard(int *lock)
+{
+	(void)lock;
+}
+
+#endif /* JENT_ARCH_MEM_FORK */
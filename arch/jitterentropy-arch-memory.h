@@ -45,13 +45,29 @@
  * Provides (defined in arch/jitterentropy-arch-memory.c):
  *   - jent_zalloc(len, flags): allocate zeroed memory, locked into RAM where
  *     the platform supports it (mlock, VirtualLock, libgcrypt secmem, OpenSSL
- *     secure heap, ...). Of the collector flags only JENT_FORCE_SECURE_MEM is
- *     consulted: it turns secure memory the environment does not grant from a
- *     silent fallback to ordinary memory into an allocation failure.
+ *     secure heap, ...). Of the collector flags only JENT_FORCE_SECURE_MEM and
+ *     JENT_HUGE_PAGES are consulted: the former turns secure memory the
+ *     environment does not grant from a silent fallback to ordinary memory
+ *     into an allocation failure, the latter asks the POSIX backend for huge
+ *     pages, never failing for want of them. The POSIX backend serves objects
+ *     of up to 1 kB that demand secure memory from shared locked slabs
+ *     rather than a mapping each, except on a host with several NUMA nodes.
  *   - jent_zfree(ptr, len): zero and release such an allocation.
+ *   - jent_free_nonsensitive(ptr, len): release one without zeroing it
+ *     first, for memory that holds nothing secret.
  *   - jent_memset_secure(s, n): wipe a buffer in a way the compiler may
  *     not optimize away.
  *   - jent_secure_memory_supported(): whether the active path locks and wipes.
+ *   - jent_memory_bind_node(ptr, len, node), jent_memory_node(ptr),
+ *     jent_memory_local_node() and jent_memory_nodes(): move an allocation to
+ *     a NUMA node, report the node it is on, the node of the calling CPU and
+ *     the number of nodes the process may allocate from.
+ *     jent_memory_bind_alloc(ptr, len, node) binds an allocation of
+ *     jent_zalloc() including the partial page it owns. Linux user space only;
+ *     elsewhere the move fails with -EOPNOTSUPP and the nodes are -1.
+ *   - jent_fork_generation(): a counter that changes in the child of every
+ *     fork(), which duplicates all of the memory above, and
+ *     jent_fork_guard(lock): a spin lock no fork() may copy while it is held.
  *
  * The dispatch order is:
  *   - LIBGCRYPT     -> gcry_malloc_secure / gcry_free
@@ -101,6 +117,17 @@ void *jent_zalloc(size_t len, unsigned int flags);
  */
 void jent_zfree(void *ptr, size_t len);
 
+/*
+ * Releases what jent_zalloc() returned like jent_zfree(), but without the
+ * byte-wise wipe where the backend lets it go: for the memory access region,
+ * whose contents are counters the noise source bumps and never reads into the
+ * entropy pool. Wiping a region of hundreds of MB dominated the time a
+ * collector took to free. Pages returned to the operating system are zeroed
+ * by it before they are handed out again; the libgcrypt, AWS-LC and OpenSSL
+ * secure arenas and the kernel wipe regardless.
+ */
+void jent_free_nonsensitive(void *ptr, size_t len);
+
 /*
  * Whether an allocation made with @flags is known to yield secure memory: the
  * backend capability reported by jent_secure_memory_supported(), narrowed to
@@ -112,6 +139,45 @@ void jent_zfree(void *ptr, size_t len);
  */
 int jent_memory_is_secure(unsigned int flags);
 
+/*
+ * NUMA placement of an allocation. jent_memory_bind_node() binds the pages
+ * lying entirely within [@ptr, @ptr + @len) to @node and moves those already
+ * faulted in; it returns 0, -EINVAL for a bad node or a negative errno of the
+ * system, -EOPNOTSUPP where NUMA placement is not available. The two node
+ * queries return a node number or -1 when it cannot be told;
+ * jent_memory_nodes() returns 1 for a single node or no NUMA placement and 2
+ * for several.
+ */
+int jent_memory_bind_node(void *ptr, size_t len, int node);
+int jent_memory_node(const void *ptr);
+int jent_memory_local_node(void);
+int jent_memory_nodes(void);
+
+/*
+ * jent_memory_bind_node() for an allocation of jent_zalloc(): where the
+ * backend gave it pages of its own, the partial last page is bound as well,
+ * so that an object smaller than a page moves at all.
+ */
+int jent_memory_bind_alloc(void *ptr, size_t len, int node);
+
+/*
+ * The fork generation of the calling process: it differs from the one read in
+ * the parent once fork() returned in the child, so that a collector recorded
+ * with one generation and read with another knows it is a copy. Counted by a
+ * pthread_atfork() handler on the POSIX backends; a child created by a raw
+ * clone() or vfork() system call is not seen. 0 where there is no fork().
+ */
+uint32_t jent_fork_generation(void);
+
+/*
+ * Have the same handlers take the spin lock @lock - 0 when free, 1 when held,
+ * taken with jent_atomic_exchange_int() - before fork() and release it after,
+ * in the parent and in the child, so that a child never inherits it held by a
+ * thread it does not have. Registering a lock twice is harmless. Nothing to do
+ * where there is no fork().
+ */
+void jent_fork_guard(int *lock);
+
 /*
  * jent_secure_memory_supported() - which reports whether the active backend
  * provides locked / wiped memory - is part of the public API and is declared
@@ -180,6 +180,41 @@ extern "C" {
 				   is always attempted; this flag only turns a
 				   refusal into an error. It is implied by
 				   JENT_NTG1 and JENT_FORCE_FIPS. */
+#define JENT_ADAPTIVE_OSR (1<<9) /* Allow jent_read_entropy_safe() to lower
+				    the oversampling rate, memory size and hash
+				    loop count raised by a health test recovery
+				    again once the collector ran without a
+				    health test failure for a while and the
+				    lower configuration passes the power-up
+				    test. Never below the configuration the
+				    collector was allocated with. */
+#define JENT_SCHED_NOISE (1<<17) /* Add a third noise source timing a round
+				    trip through the scheduler: each time delta
+				    also covers and separately health-tests a
+				    jent_yield() call, reporting its own
+				    JENT_ERR_SCHED_* errors, and with
+				    JENT_NTG1 or FIPS mode the startup
+				    samples it alone first. Useful where the memory access and
+				    hash loop jitter are weak; record its
+				    entropy rate before lowering the
+				    oversampling rate for it. */
+#define JENT_HUGE_PAGES (1<<18) /* Back a memory access region of 2 MB or
+				   more with huge pages: explicit ones where
+				   the system has them reserved, transparent
+				   ones otherwise, 2 MB aligned memory where
+				   neither exists. Fewer TLB misses, hence
+				   different - record the entropy rate before
+				   relying on it. POSIX platforms only. */
+#define JENT_SHARED_MEMORY (1<<19) /* Share the memory access region with
+				      the other collectors of this flag, the
+				      same memory size and the same NUMA
+				      node instead of allocating one per
+				      collector. Each starts walking it at an
+				      offset of its own. The contents carry no
+				      secret, only the access timing counts;
+				      record the entropy rate with the
+				      collectors sharing a region running
+				      before relying on it. */
 
 #if defined(LINUX_KERNEL) && !defined(UINT32_C)
 #define UINT32_C(c)	c ## U
@@ -233,6 +268,54 @@ extern "C" {
 #define JENT_HASHLOOP_128		JENT_HASHLOOP_TO_FLAGS(UINT32_C(7))
 #define JENT_MAX_HASHLOOP		JENT_HASHLOOP_128
 
+/*
+ * Flags field adding a fraction in quarters to the oversampling rate: an osr
+ * of 3 with JENT_OSR_PLUS_1_4 collects 3.25 times the data of one output
+ * block. Ignored at JENT_MAX_OSR.
+ */
+#define JENT_FLAGS_TO_OSR_FRACTION_SHIFT 10
+#define JENT_OSR_FRACTION_TO_FLAGS(val)	((val) << JENT_FLAGS_TO_OSR_FRACTION_SHIFT)
+#define JENT_OSR_FRACTION_MASK		JENT_OSR_FRACTION_TO_FLAGS(0x3)
+#define JENT_FLAGS_TO_OSR_FRACTION(val)	(((val) >> \
+					  JENT_FLAGS_TO_OSR_FRACTION_SHIFT) \
+					 & 0x3)
+#define JENT_OSR_PLUS_0			JENT_OSR_FRACTION_TO_FLAGS(UINT32_C(0))
+#define JENT_OSR_PLUS_1_4		JENT_OSR_FRACTION_TO_FLAGS(UINT32_C(1))
+#define JENT_OSR_PLUS_1_2		JENT_OSR_FRACTION_TO_FLAGS(UINT32_C(2))
+#define JENT_OSR_PLUS_3_4		JENT_OSR_FRACTION_TO_FLAGS(UINT32_C(3))
+
+/*
+ * Flags field selecting the access pattern of the memory access noise source.
+ * JENT_MEMACCESS_DEFAULT is the pattern the library is compiled with, the
+ * pseudorandom walk unless built for raw memory access measurements.
+ */
+#define JENT_FLAGS_TO_MEMACCESS_SHIFT	12
+#define JENT_MEMACCESS_TO_FLAGS(val)	((val) << JENT_FLAGS_TO_MEMACCESS_SHIFT)
+#define JENT_MEMACCESS_MASK		JENT_MEMACCESS_TO_FLAGS(0x7)
+#define JENT_FLAGS_TO_MEMACCESS(val)	(((val) >> \
+					  JENT_FLAGS_TO_MEMACCESS_SHIFT) & 0x7)
+#define JENT_MEMACCESS_DEFAULT		JENT_MEMACCESS_TO_FLAGS(UINT32_C(0))
+#define JENT_MEMACCESS_STRIDE		JENT_MEMACCESS_TO_FLAGS(UINT32_C(1))
+#define JENT_MEMACCESS_RANDOM		JENT_MEMACCESS_TO_FLAGS(UINT32_C(2))
+#define JENT_MEMACCESS_CHASE		JENT_MEMACCESS_TO_FLAGS(UINT32_C(3))
+#define JENT_MEMACCESS_CACHE_STRIDE	JENT_MEMACCESS_TO_FLAGS(UINT32_C(4))
+#define JENT_MEMACCESS_MULTISTREAM	JENT_MEMACCESS_TO_FLAGS(UINT32_C(5))
+#define JENT_MEMACCESS_MAX		JENT_MEMACCESS_MULTISTREAM
+
+/*
+ * Flags field selecting the computation the hash loop noise source times.
+ * JENT_HASHKERNEL_SHA3 is the SHA3-256 operation the library always used.
+ */
+#define JENT_FLAGS_TO_HASHKERNEL_SHIFT	15
+#define JENT_HASHKERNEL_TO_FLAGS(val)	((val) << JENT_FLAGS_TO_HASHKERNEL_SHIFT)
+#define JENT_HASHKERNEL_MASK		JENT_HASHKERNEL_TO_FLAGS(0x3)
+#define JENT_FLAGS_TO_HASHKERNEL(val)	(((val) >> \
+					  JENT_FLAGS_TO_HASHKERNEL_SHIFT) & 0x3)
+#define JENT_HASHKERNEL_SHA3		JENT_HASHKERNEL_TO_FLAGS(UINT32_C(0))
+#define JENT_HASHKERNEL_MULDIV		JENT_HASHKERNEL_TO_FLAGS(UINT32_C(1))
+#define JENT_HASHKERNEL_BRANCH		JENT_HASHKERNEL_TO_FLAGS(UINT32_C(2))
+#define JENT_HASHKERNEL_MAX		JENT_HASHKERNEL_BRANCH
+
 #ifdef JENT_PRIVATE_COMPILE
 # define JENT_PRIVATE_STATIC static
 #elif defined(LINUX_KERNEL)
@@ -373,6 +456,74 @@ JENT_PRIVATE_STATIC
 ssize_t jent_read_entropy(struct rand_data *ec, char *data, size_t len);
 JENT_PRIVATE_STATIC
 ssize_t jent_read_entropy_safe(struct rand_data **ec, char *data, size_t len);
+/*
+ * Read like jent_read_entropy(), but within budget, in the units of the
+ * collector's time source (nanoseconds on most platforms): no block is started
+ * or continued once the budget has passed, and the samples of the block it
+ * ends in are kept for the next read from the collector, which continues it.
+ * The budget is overrun by one sample and the generation of a block at most.
+ * Returns the bytes of the blocks completed, possibly 0, or an error code of
+ * jent_read_entropy().
+ */
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_timed(struct rand_data *ec, char *data, size_t len,
+				uint64_t budget);
+/*
+ * Collect for a caller without threads, e.g. a firmware event loop: take at
+ * most samples measurements for the current block - the one priming the time
+ * stamp included, but at least one of the block besides it - and keep the
+ * block in the collector between calls. Returns 1 once the block is complete, which holds until
+ * jent_read_entropy_step() consumed it, 0 while it needs more samples, or an
+ * error code of jent_read_entropy(); a health test failure is reported by the
+ * step that takes the failing sample.
+ */
+JENT_PRIVATE_STATIC
+int jent_entropy_step(struct rand_data *ec, unsigned int samples);
+/*
+ * Copy up to 32 bytes of the block jent_entropy_step() completed to data.
+ * Returns the bytes copied, 0 when no block is complete, or an error code of
+ * jent_read_entropy(). A jent_read_entropy*() call uses a completed block
+ * first as well. In a fork() child a block completed or begun before the
+ * fork() is dropped, and the child steps through a block of its own.
+ */
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_step(struct rand_data *ec, char *data, size_t len);
+/* One buffer of jent_read_entropy_iov() */
+struct jent_iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+/*
+ * Fill iovcnt buffers in one call, e.g. to seed a set of per-worker DRBGs:
+ * the internal timer is started and stopped once for the whole request, and
+ * that is all the call saves. Each buffer is filled with a sequence of
+ * ordinary blocks exactly as a jent_read_entropy() call of its own would
+ * fill it, no block is split between two buffers, and the health tests
+ * judge every block as they do there - there is neither one evaluation for
+ * the whole vector nor a per-buffer mode. Returns the bytes delivered over all buffers or
+ * an error code of jent_read_entropy(), which leaves the contents of the
+ * buffers undefined.
+ */
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_iov(struct rand_data *ec,
+			      const struct jent_iovec *iov,
+			      unsigned int iovcnt);
+/*
+ * Generate len bytes and hand them to sink block by block, at most 32 bytes at
+ * a time, instead of into a buffer of the caller: the sink may write them to a
+ * ring buffer, a file descriptor or absorb them into the XOF of a DRBG it
+ * seeds. The sink reads each block where the library generates it, and the
+ * block is wiped once the sink returned, so seeding output never exists in
+ * memory of the caller. A sink returning non-zero ends the request, e.g. to
+ * apply backpressure. The sink runs in the middle of the generation and must
+ * not call back into the library with the same collector. Returns the bytes
+ * handed to the sink or an error code of jent_read_entropy().
+ */
+typedef int (*jent_read_entropy_sink)(void *ctx, const char *data,
+				      size_t len);
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_stream(struct rand_data *ec, size_t len,
+				 jent_read_entropy_sink sink, void *ctx);
 /* initialize an instance of the entropy collector */
 JENT_PRIVATE_STATIC
 struct rand_data *jent_entropy_collector_alloc(unsigned int osr,
@@ -381,12 +532,166 @@ struct rand_data *jent_entropy_collector_alloc(unsigned int osr,
 JENT_PRIVATE_STATIC
 void jent_entropy_collector_free(struct rand_data *entropy_collector);
 
+/*
+ * Allocate a collector like jent_entropy_collector_alloc(), but return before
+ * its startup collected the first blocks. Until the startup completed,
+ * jent_read_entropy() returns JENT_ERR_STARTING, while
+ * jent_read_entropy_safe() completes it before the read. Returns NULL on
+ * invalid arguments or when the memory cannot be allocated.
+ */
+JENT_PRIVATE_STATIC
+struct rand_data *jent_entropy_collector_alloc_deferred(unsigned int osr,
+							unsigned int flags);
+
+/*
+ * Run one round of the startup of a collector from
+ * jent_entropy_collector_alloc_deferred() - one block of the time
+ * jent_entropy_collector_alloc() takes - so that the startups of several
+ * collectors can be interleaved, or moved to a thread of the caller. A health
+ * test failure during the startup replaces *ec with a collector of a larger
+ * configuration, as jent_read_entropy_safe() does. Returns 0 once the startup
+ * completed (at once for a started collector), JENT_ERR_STARTING while it needs
+ * another round, or an error code of jent_read_entropy() when it cannot
+ * complete; the collector then only remains to be freed.
+ */
+JENT_PRIVATE_STATIC
+int jent_entropy_collector_start(struct rand_data **ec);
+
+/* Alignment of the memory handed to jent_entropy_collector_init() */
+#define JENT_COLLECTOR_ALIGN 64
+
+/*
+ * Bytes of memory a collector with osr and flags needs when built by
+ * jent_entropy_collector_init(), or 0 for an unsupported osr.
+ */
+JENT_PRIVATE_STATIC
+size_t jent_entropy_collector_size(unsigned int osr, unsigned int flags);
+
+/*
+ * Build a collector in the caller memory buf of len bytes, aligned to
+ * JENT_COLLECTOR_ALIGN and at least jent_entropy_collector_size(osr, flags)
+ * long, without allocating. Such a collector runs without the internal timer
+ * thread and cannot be reallocated: a health test failure that
+ * jent_read_entropy_safe() would recover from with a larger configuration is
+ * returned as an error instead. jent_entropy_collector_free() wipes buf but
+ * leaves it to the caller to release; locking it in memory is the caller's
+ * business as well. JENT_FORCE_SECURE_MEM is therefore refused, while the
+ * secure memory JENT_NTG1 and JENT_FORCE_FIPS imply is left to the caller to
+ * provide: jent_status() reports secureMemory false either way. Call
+ * jent_entropy_init_ex() beforehand to keep the power-up test out of this
+ * call. Returns NULL on invalid arguments, among them JENT_FORCE_SECURE_MEM,
+ * a too short buf or a failing startup.
+ */
+JENT_PRIVATE_STATIC
+struct rand_data *jent_entropy_collector_init(void *buf, size_t len,
+					      unsigned int osr,
+					      unsigned int flags);
+
+/*
+ * Hold the time one output block takes near block_time, in the units of the
+ * collector's time source (nanoseconds on most platforms): while it is
+ * exceeded, the memory access and hash loop counts are lowered step by step,
+ * within bounds, and they are raised back once there is room again. A health
+ * test failure restores the allocated counts at once. 0 turns it off.
+ * jent_status() reports the decisions. Returns 0, -EINVAL for a NULL
+ * collector and -EOPNOTSUPP in the FIPS and NTG.1 modes.
+ */
+JENT_PRIVATE_STATIC
+int jent_set_latency_target(struct rand_data *ec, uint64_t block_time);
+
+/*
+ * Bind the memory of the collector - its state, memory access region and hash
+ * state - to NUMA node node, moving the pages already in use, so that a
+ * collector driven from a CPU of that node works on local memory. -1 selects
+ * the node of the calling CPU. The binding survives a reallocation by jent_read_entropy_safe(). Pinning the
+ * calling thread stays with the caller.
+ * Returns 0, -EINVAL for a NULL collector or a bad node, -EOPNOTSUPP where NUMA
+ * placement is not available (anything but Linux user space), or the negative
+ * errno of the system.
+ */
+JENT_PRIVATE_STATIC
+int jent_entropy_collector_bind_node(struct rand_data *ec, int node);
+
 /* initialization of entropy collector */
 JENT_PRIVATE_STATIC
 int jent_entropy_init(void);
 JENT_PRIVATE_STATIC
 int jent_entropy_init_ex(unsigned int osr, unsigned int flags);
 
+/*
+ * Find the fastest configuration this host passes the health checks with.
+ * Each memory size and hash loop count of a small grid is tried at the lowest
+ * oversampling rate, in quarter steps from *osr on, that passes the power-up
+ * test and a most common value estimate of the min entropy; the passing
+ * configurations are benchmarked against each other.
+ *
+ * On entry *osr and *flags are the starting point: the rate the search begins
+ * at and the flags every candidate keeps, a JENT_MAX_MEMSIZE_* field capping
+ * the memory size. On success they hold the winner - a profile to store and
+ * pass to jent_entropy_collector_alloc() as is. Takes a second or more.
+ * Returns 0, -1 on invalid arguments or allocation failure, or EHEALTH on a
+ * host where no candidate passed.
+ */
+JENT_PRIVATE_STATIC
+int jent_autotune(unsigned int *osr, unsigned int *flags);
+
+/*
+ * A pool of collectors that completed their startup, for callers that cannot
+ * wait for it when they need a collector. jent_collector_pool_alloc() starts
+ * size collectors of osr and flags, 1 to 1024, and returns NULL when one
+ * cannot be had. jent_collector_pool_get() takes one off the pool, or
+ * allocates one the usual way when it is empty; each collector is handed out
+ * once. jent_collector_pool_put() returns a collector taken from the pool for
+ * reuse, without any block it began and with its latency target cleared, or
+ * frees it when the pool is full, the collector failed a health or self test
+ * or no longer has the OSR and flags of the pool. jent_collector_pool_refill() starts collectors until the pool
+ * is full again, returning 0 or -ENOMEM: the library starts no thread for it,
+ * the caller runs it on one of its own. jent_collector_pool_count() reports
+ * the collectors ready, jent_collector_pool_free() frees them with the pool.
+ * All but jent_collector_pool_free() may be called from several threads.
+ */
+struct jent_collector_pool;
+
+JENT_PRIVATE_STATIC
+struct jent_collector_pool *jent_collector_pool_alloc(unsigned int size,
+						      unsigned int osr,
+						      unsigned int flags);
+JENT_PRIVATE_STATIC
+struct rand_data *jent_collector_pool_get(struct jent_collector_pool *pool);
+JENT_PRIVATE_STATIC
+void jent_collector_pool_put(struct jent_collector_pool *pool,
+			     struct rand_data *ec);
+JENT_PRIVATE_STATIC
+int jent_collector_pool_refill(struct jent_collector_pool *pool);
+JENT_PRIVATE_STATIC
+unsigned int jent_collector_pool_count(struct jent_collector_pool *pool);
+JENT_PRIVATE_STATIC
+void jent_collector_pool_free(struct jent_collector_pool *pool);
+
+/*
+ * An XDRBG-256 child of a collector, for a thread that needs a high rate of
+ * output rather than fresh jitter in every byte. jent_drbg_child_alloc() seeds
+ * the child from *ec and returns NULL when that fails. The child reseeds from
+ * *ec after reseed_bytes of output, 0 for 1 MiB, and after a fork() copied it.
+ * It reseeds with jent_read_entropy_safe(ec), which may replace *ec after a
+ * health test failure, so ec is the caller's pointer to the collector and has
+ * to stay valid, and the collector in use, until the last child is freed.
+ * jent_drbg_child_generate() returns len or an error code of
+ * jent_read_entropy_safe() from a failed reseed. A child is owned by one
+ * thread and takes no lock; the reseeds of all children are serialized.
+ * jent_drbg_child_free() wipes the child.
+ */
+struct jent_drbg_child;
+
+JENT_PRIVATE_STATIC
+struct jent_drbg_child *jent_drbg_child_alloc(struct rand_data **ec,
+					      uint64_t reseed_bytes);
+JENT_PRIVATE_STATIC
+ssize_t jent_drbg_child_generate(struct jent_drbg_child *child, char *data,
+				 size_t len);
+JENT_PRIVATE_STATIC
+void jent_drbg_child_free(struct jent_drbg_child *child);
+
 /*
  * Run the known answer tests of the conditioning component: SHA3-256 and
  * XDRBG-256. jent_entropy_init* performs them before anything else; they are
@@ -560,6 +865,17 @@ void jent_notime_fini(void *ctx);
 #define JENT_ERR_SELFTEST	(-11) /* A jent_selftest run bound to this
 					 instance failed; the failure is
 					 permanent */
+#define JENT_ERR_STARTING	(-12) /* The startup of a collector from
+					 jent_entropy_collector_alloc_deferred
+					 has not completed yet */
+#define JENT_ERR_SCHED_RCT	(-13) /* Intermittent RCT failure of the
+					 scheduling noise source */
+#define JENT_ERR_SCHED_APT	(-14) /* Intermittent APT failure of the
+					 scheduling noise source */
+#define JENT_ERR_SCHED_RCT_PERMANENT (-15) /* Permanent RCT failure of the
+					      scheduling noise source */
+#define JENT_ERR_SCHED_APT_PERMANENT (-16) /* Permanent APT failure of the
+					      scheduling noise source */
 /* -- END error codes for jent_read_entropy / jent_read_entropy_safe -- */
 
 /* -- BEGIN error masks for health tests -- */
@@ -567,12 +883,18 @@ void jent_notime_fini(void *ctx);
 #define JENT_APT_FAILURE	2 /* Failure in APT health test. */
 #define JENT_LAG_FAILURE	4 /* Failure in Lag predictor health test. */
 #define JENT_RCT_MEM_FAILURE	8 /* Failure in RCT with memory health test. */
+#define JENT_SCHED_RCT_FAILURE	16 /* Failure in RCT of the scheduling noise
+				      source. */
+#define JENT_SCHED_APT_FAILURE	32 /* Failure in APT of the scheduling noise
+				      source. */
 #define JENT_PERMANENT_FAILURE_SHIFT	16
 #define JENT_PERMANENT_FAILURE(x)	((x) << JENT_PERMANENT_FAILURE_SHIFT)
 #define JENT_RCT_FAILURE_PERMANENT	JENT_PERMANENT_FAILURE(JENT_RCT_FAILURE)
 #define JENT_APT_FAILURE_PERMANENT	JENT_PERMANENT_FAILURE(JENT_APT_FAILURE)
 #define JENT_LAG_FAILURE_PERMANENT	JENT_PERMANENT_FAILURE(JENT_LAG_FAILURE)
 #define JENT_RCT_MEM_FAILURE_PERMANENT	JENT_PERMANENT_FAILURE(JENT_RCT_MEM_FAILURE)
+#define JENT_SCHED_RCT_FAILURE_PERMANENT JENT_PERMANENT_FAILURE(JENT_SCHED_RCT_FAILURE)
+#define JENT_SCHED_APT_FAILURE_PERMANENT JENT_PERMANENT_FAILURE(JENT_SCHED_APT_FAILURE)
 /* -- END error masks for health tests -- */
 
 #ifdef __cplusplus
@@ -36,6 +36,8 @@ static inline int jent_map_read_error(ssize_t ret)
 	case JENT_ERR_APT_PERMANENT:
 	case JENT_ERR_LAG_PERMANENT:
 	case JENT_ERR_RCT_MEM_PERMANENT:
+	case JENT_ERR_SCHED_RCT_PERMANENT:
+	case JENT_ERR_SCHED_APT_PERMANENT:
 	case JENT_ERR_SELFTEST:
 		/* Permanent health test error */
 		if (fips_enabled)
@@ -53,6 +55,8 @@ static inline int jent_map_read_error(ssize_t ret)
 	case JENT_ERR_APT:
 	case JENT_ERR_LAG:
 	case JENT_ERR_RCT_MEM:
+	case JENT_ERR_SCHED_RCT:
+	case JENT_ERR_SCHED_APT:
 		/* Unrecovered intermittent health test error */
 		pr_warn_ratelimited("Jitter RNG intermittent health test failure not recovered\n");
 		return -EAGAIN;
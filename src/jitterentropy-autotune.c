@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2026, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "jitterentropy.h"
+#include "jitterentropy-base.h"
+#include "jitterentropy-health.h"
+#include "jitterentropy-internal.h"
+#include "jitterentropy-noise.h"
+#include "jitterentropy-timer.h"
+
+/***************************************************************************
+ * Configuration autotuning
+ *
+ * jent_autotune() walks a small grid of memory sizes and hash loop counts. For
+ * each it searches the lowest oversampling rate, in quarters, that
+ *
+ * 1. passes the power-up test of jent_entropy_init_ex(),
+ *
+ * 2. yields a collector whose startup does not raise the configuration, and
+ *
+ * 3. passes the most common value estimate of SP800-90B section 6.3.1 on
+ *    JENT_APT_WINDOW_SIZE time deltas: the min entropy -log2(p_u) derived
+ *    from the upper 99% confidence bound p_u of the most common value
+ *    probability is at least the entropy rate the oversampling rate claims
+ *    (1/osr, or 8/osr with JENT_NTG1). A delta the stuck test rejects counts
+ *    as one more occurrence of the most common value.
+ *
+ * The passing configuration of every grid point then generates
+ * JENT_AUTOTUNE_BLOCKS output blocks, timed with the time source of its
+ * collector, and the one doing so in the least time wins. Higher oversampling
+ * rates of the same grid point are not benchmarked: they only ever take longer.
+ ***************************************************************************/
+
+/* Output blocks each passing configuration generates for the benchmark */
+#define JENT_AUTOTUNE_BLOCKS		16
+
+/* Whole oversampling rates above the starting one the search goes to */
+#define JENT_AUTOTUNE_OSR_STEPS		2
+
+/*
+ * The grid. A memory size of 0 is the size jent_update_memsize() derives from
+ * the caches; a caller-set JENT_MAX_MEMSIZE_* caps it.
+ */
+static const unsigned int jent_autotune_memsize[] = {
+	0,
+	JENT_MAX_MEMSIZE_8kB,
+	JENT_MAX_MEMSIZE_64kB,
+	JENT_MAX_MEMSIZE_512kB,
+};
+
+static const unsigned int jent_autotune_hashloop[] = {
+	JENT_HASHLOOP_1,
+	JENT_HASHLOOP_4,
+};
+
+/*
+ * Highest count of the most common value in JENT_APT_WINDOW_SIZE deltas for
+ * which the estimate still supports an entropy rate of 1/osr, indexed by
+ * osr - 1. A fractional oversampling rate uses the entry of its whole part,
+ * which claims the higher rate. Computed as the largest C with
+ *
+ * p = C / 512, p_u = min(1, p + 2.576 * sqrt(p * (1 - p) / 511))
+ * -log2(p_u) >= 1/osr
+ */
+static const unsigned short jent_autotune_mcv_lookup[] =
+	{ 227, 334, 380, 406, 423, 435, 443, 450, 455, 460,
+	  463, 466, 469, 471, 473, 475, 476, 478, 479, 480 };
+
+/*
+ * The same for the entropy rate of 8/osr claimed with JENT_NTG1. No count
+ * supports 8 bits per delta at osr 1 in a window of this size.
+ */
+static const unsigned short jent_autotune_mcv_lookup_ntg1[] =
+	{   0,  20,  61, 104, 142, 175, 203, 227, 247, 264,
+	  280, 293, 305, 316, 325, 334, 342, 349, 355, 361 };
+
+/*
+ * The most common value estimate described above. Stuck deltas carry no
+ * entropy: they are not compared as values but all count towards the most
+ * common one.
+ *
+ * @return 0 when the estimate supports the entropy rate of the collector,
+ *	   1 otherwise, -1 on allocation failure
+ */
+static int jent_autotune_mcv(struct rand_data *ec)
+{
+	const unsigned short *lookup = (ec->flags & JENT_NTG1) ?
+		jent_autotune_mcv_lookup_ntg1 : jent_autotune_mcv_lookup;
+	uint64_t *deltas;
+	unsigned int i, j, n = 0, stuck = 0, count, cutoff, max = 0;
+	int ret = 0;
+
+	JENT_BUILD_BUG_ON(JENT_ARRAY_SIZE(jent_autotune_mcv_lookup) <
+			  JENT_MAX_OSR);
+	JENT_BUILD_BUG_ON(JENT_ARRAY_SIZE(jent_autotune_mcv_lookup_ntg1) <
+			  JENT_MAX_OSR);
+	JENT_BUILD_BUG_ON(JENT_APT_WINDOW_SIZE != 512);
+
+	cutoff = lookup[ec->osr - 1];
+
+	deltas = jent_zalloc(JENT_APT_WINDOW_SIZE * sizeof(uint64_t), 0);
+	if (!deltas)
+		return -1;
+
+	if (jent_notime_settick(ec)) {
+		ret = -1;
+		goto out;
+	}
+
+	for (i = 0; i < JENT_APT_WINDOW_SIZE; i++) {
+		if (jent_measure_jitter(ec, 0, &deltas[n])) {
+			stuck++;
+			continue;
+		}
+		deltas[n++] &= JENT_APT_MASK;
+	}
+
+	jent_notime_unsettick(ec);
+
+	for (i = 0; i < n && stuck + max <= cutoff; i++) {
+		count = 0;
+		for (j = i; j < n; j++) {
+			if (deltas[j] == deltas[i])
+				count++;
+		}
+		if (count > max)
+			max = count;
+	}
+
+	if (stuck + max > cutoff || jent_health_failure(ec))
+		ret = 1;
+
+out:
+	jent_zfree(deltas, JENT_APT_WINDOW_SIZE * sizeof(uint64_t));
+	return ret;
+}
+
+/*
+ * Benchmark sink: time stamp every block with the time source of the
+ * collector. The read keeps the internal timer of a collector using it ticking
+ * for all blocks, which a counter restarted by every read would not.
+ */
+struct jent_autotune_bench {
+	struct rand_data *ec;
+	uint64_t first, last;
+	unsigned int blocks;
+};
+
+static int jent_autotune_sink(void *ctx, const char *data, size_t len)
+{
+	struct jent_autotune_bench *bench = ctx;
+
+	(void)data;
+	(void)len;
+
+	jent_get_nstime_internal(bench->ec, &bench->last);
+	if (!bench->blocks++)
+		bench->first = bench->last;
+
+	return 0;
+}
+
+/*
+ * Search the lowest passing oversampling rate of one grid point and benchmark
+ * it.
+ *
+ * @param[in] osr_quarters Starting oversampling rate in quarters
+ * @param[in] flags Flags of the grid point
+ * @param[out] best_osr Oversampling rate of the passing configuration
+ * @param[out] best_flags Flags of the passing configuration
+ * @param[out] elapsed Time the benchmark took, in units of the time source
+ * @param[out] notime Whether that is the internal timer
+ *
+ * @return 0 on success, EHEALTH when no rate passed, -1 on allocation failure
+ */
+static int jent_autotune_point(unsigned int osr_quarters, unsigned int flags,
+			       unsigned int *best_osr,
+			       unsigned int *best_flags, uint64_t *elapsed,
+			       int *notime)
+{
+	struct jent_autotune_bench bench = { 0 };
+	struct rand_data *ec = NULL;
+	unsigned int q, osr, cflags;
+	int ret = 0;
+
+	for (q = osr_quarters;
+	     q <= osr_quarters + 4 * JENT_AUTOTUNE_OSR_STEPS &&
+	     q <= JENT_MAX_OSR * 4;
+	     q++) {
+		osr = q / 4;
+		cflags = (flags & ~(unsigned int)JENT_OSR_FRACTION_MASK) |
+			 JENT_OSR_FRACTION_TO_FLAGS(q % 4);
+
+		if (jent_entropy_init_ex(osr, cflags))
+			continue;
+
+		ec = jent_entropy_collector_alloc(osr, cflags);
+		if (!ec)
+			continue;
+
+		/* The startup had to recover: this rate did not pass */
+		if (JENT_OSR_QUARTERS(ec) != q) {
+			jent_entropy_collector_free(ec);
+			ec = NULL;
+			continue;
+		}
+
+		ret = jent_autotune_mcv(ec);
+		if (!ret)
+			break;
+
+		jent_entropy_collector_free(ec);
+		ec = NULL;
+		if (ret < 0)
+			return ret;
+	}
+
+	if (!ec)
+		return EHEALTH;
+
+	/*
+	 * The time from the first block to the last is that of generating
+	 * JENT_AUTOTUNE_BLOCKS blocks.
+	 */
+	bench.ec = ec;
+	if (jent_read_entropy_stream(ec,
+			(JENT_AUTOTUNE_BLOCKS + 1) * JENT_SHA3_256_SIZE_DIGEST,
+			jent_autotune_sink, &bench) < 0)
+		ret = EHEALTH;
+
+	*best_osr = ec->osr;
+	/*
+	 * The flags tested, not the ones the collector normalized them to: a
+	 * concrete memory size there would pin the collector of this profile
+	 * to it.
+	 */
+	*best_flags = cflags;
+	*elapsed = bench.last - bench.first;
+	*notime = ec->enable_notime;
+
+	jent_entropy_collector_free(ec);
+
+	return ret;
+}
+
+JENT_PRIVATE_STATIC
+int jent_autotune(unsigned int *osr, unsigned int *flags)
+{
+	unsigned int base_flags, cap, mem, i, j;
+	unsigned int osr_quarters, cand_osr, cand_flags;
+	uint64_t elapsed, best = 0;
+	int ret, notime, best_notime = 0, found = 0;
+
+	if (!osr || !flags)
+		return -1;
+
+	if (*osr > JENT_MAX_OSR)
+		return -1;
+
+	osr_quarters = ((*osr < JENT_MIN_OSR) ? JENT_MIN_OSR : *osr) * 4 +
+		       JENT_FLAGS_TO_OSR_FRACTION(*flags);
+	if (osr_quarters > JENT_MAX_OSR * 4)
+		osr_quarters = JENT_MAX_OSR * 4;
+	cap = JENT_FLAGS_TO_MAX_MEMSIZE(*flags);
+	base_flags = *flags & ~(JENT_MAX_MEMSIZE_MASK |
+				(unsigned int)JENT_MAX_HASHLOOP_MASK |
+				(unsigned int)JENT_OSR_FRACTION_MASK);
+
+	for (i = 0; i < JENT_ARRAY_SIZE(jent_autotune_memsize); i++) {
+		mem = JENT_FLAGS_TO_MAX_MEMSIZE(jent_autotune_memsize[i]);
+
+		if (base_flags & JENT_DISABLE_MEMORY_ACCESS) {
+			/* Only the hash loop is left to tune */
+			if (i)
+				break;
+		} else if (cap) {
+			if (!mem)
+				mem = cap;
+			else if (mem >= cap)
+				continue;
+		}
+
+		for (j = 0; j < JENT_ARRAY_SIZE(jent_autotune_hashloop); j++) {
+			ret = jent_autotune_point(osr_quarters,
+				base_flags | JENT_MAX_MEMSIZE_TO_FLAGS(mem) |
+				jent_autotune_hashloop[j],
+				&cand_osr, &cand_flags, &elapsed, &notime);
+			if (ret < 0)
+				return ret;
+			if (ret)
+				continue;
+
+			/*
+			 * Times of the internal timer and of the hardware one
+			 * do not compare. Should the internal timer be forced
+			 * during the search, the hardware one wins: it needs
+			 * no counting thread per read.
+			 */
+			if (found && notime != best_notime) {
+				if (notime)
+					continue;
+			} else if (found && elapsed >= best) {
+				continue;
+			}
+
+			*osr = cand_osr;
+			*flags = cand_flags;
+			best = elapsed;
+			best_notime = notime;
+			found = 1;
+		}
+	}
+
+	return found ? 0 : EHEALTH;
+}
@@ -212,7 +212,7 @@ static inline unsigned int jent_update_hashloop(unsigned int flags,
  * JENT_FORCE_FIPS into its test instance to get the health tests run, which is
  * not a compliance statement, and deriving the requirement there would make
  * every default allocation demand secure memory. Same reasoning as the
- * JENT_DISABLE_MEMORY_ACCESS check in _jent_entropy_collector_alloc().
+ * JENT_DISABLE_MEMORY_ACCESS check in jent_entropy_collector_prepare().
  */
 static inline unsigned int jent_update_secure_mem(unsigned int flags)
 {
@@ -226,40 +226,249 @@ static inline unsigned int jent_update_secure_mem(unsigned int flags)
  * Random Number Generation
  ***************************************************************************/
 
-/**
- * Entry function: Obtain entropy for the caller.
- *
- * This function invokes the entropy gathering logic as often to generate
- * as many bytes as requested by the caller. The entropy gathering logic
- * creates 64 bit per invocation.
- *
- * This function truncates the last 64 bit entropy value output to the exact
- * size specified by the caller.
- *
- * @param[in] ec Reference to entropy collector
- * @param[out] data pointer to buffer for storing random data -- buffer must
- *	       already exist
- * @param[in] len size of the buffer, specifying also the requested number of random
- *	     in bytes
- *
- * @return number of bytes returned when request is fulfilled or an error
- *
- * The following error codes can occur:
- *	JENT_ERR_EINVAL			(-1)  entropy_collector is NULL
- *	JENT_ERR_RCT			(-2)  RCT failed
- *	JENT_ERR_APT			(-3)  APT failed
- *	JENT_ERR_NOTIME			(-4)  The timer cannot be initialized
- *	JENT_ERR_LAG			(-5)  LAG failure
- *	JENT_ERR_RCT_PERMANENT		(-6)  RCT permanent failure
- *	JENT_ERR_APT_PERMANENT		(-7)  APT permanent failure
- *	JENT_ERR_LAG_PERMANENT		(-8)  LAG permanent failure
- *	JENT_ERR_RCT_MEM		(-9)  RCT with memory failed
- *	JENT_ERR_RCT_MEM_PERMANENT	(-10) RCT with memory permanent failure
- *	JENT_ERR_SELFTEST		(-11) A bound jent_selftest run failed,
- *					      permanently
+/*
+ * Latency controller: one step per JENT_LATENCY_WINDOW blocks. Above the
+ * target the memory access loop count is halved down to
+ * JENT_LATENCY_MEM_ACC_LOOP_MIN, then the hash loop count down to 1. Below
+ * half the target the hash loop count and then the memory access loop count
+ * are doubled back up to the values the collector was allocated with. The gap
+ * between the two thresholds keeps it from oscillating.
+ */
+static void jent_latency_control(struct rand_data *ec, uint64_t elapsed)
+{
+	/* Moving average over about eight blocks */
+	if (!ec->latency_avg)
+		ec->latency_avg = elapsed;
+	else
+		ec->latency_avg += (elapsed >> 3) - (ec->latency_avg >> 3);
+
+	if (++ec->latency_blocks < JENT_LATENCY_WINDOW)
+		return;
+	ec->latency_blocks = 0;
+
+	if (ec->latency_avg > ec->latency_target) {
+		if (ec->memaccessloops > JENT_LATENCY_MEM_ACC_LOOP_MIN) {
+			ec->memaccessloops >>= 1;
+			if (ec->memaccessloops < JENT_LATENCY_MEM_ACC_LOOP_MIN)
+				ec->memaccessloops =
+					JENT_LATENCY_MEM_ACC_LOOP_MIN;
+		} else if (ec->hashloopcnt > 1) {
+			ec->hashloopcnt >>= 1;
+		} else {
+			return;
+		}
+		ec->latency_reductions++;
+	} else if (ec->latency_avg < (ec->latency_target >> 1)) {
+		if (ec->hashloopcnt < ec->latency_hash_loops_max) {
+			ec->hashloopcnt <<= 1;
+			if (ec->hashloopcnt > ec->latency_hash_loops_max)
+				ec->hashloopcnt = ec->latency_hash_loops_max;
+		} else if (ec->memaccessloops < ec->latency_mem_loops_max) {
+			ec->memaccessloops <<= 1;
+			if (ec->memaccessloops > ec->latency_mem_loops_max)
+				ec->memaccessloops = ec->latency_mem_loops_max;
+		} else {
+			return;
+		}
+		ec->latency_restorations++;
+	}
+}
+
+/* Return to the loop counts the collector was allocated with. */
+static void jent_latency_restore(struct rand_data *ec)
+{
+	if (ec->memaccessloops != ec->latency_mem_loops_max ||
+	    ec->hashloopcnt != ec->latency_hash_loops_max)
+		ec->latency_restorations++;
+
+	ec->memaccessloops = ec->latency_mem_loops_max;
+	ec->hashloopcnt = ec->latency_hash_loops_max;
+	ec->latency_avg = 0;
+	ec->latency_blocks = 0;
+}
+
+JENT_PRIVATE_STATIC
+int jent_set_latency_target(struct rand_data *ec, uint64_t block_time)
+{
+	if (!ec)
+		return -EINVAL;
+
+	/*
+	 * The compliance modes claim the entropy of the configuration that
+	 * was assessed; the counts are not the controller's to change there.
+	 */
+	if (ec->is_fips_enabled)
+		return -EOPNOTSUPP;
+
+	ec->latency_target = block_time;
+	jent_latency_restore(ec);
+
+	return 0;
+}
+
+/*
+ * A collector is one allocation of its rand_data followed by its hash state,
+ * which the conditioning touches with every time delta, each starting on a
+ * JENT_COLLECTOR_ALIGN boundary: JENT_COLLECTOR_MEM_OFFSET bytes. In caller
+ * memory (jent_entropy_collector_init()) the memory access region follows.
  */
+#define JENT_COLLECTOR_ROUNDUP(x)					      \
+	(((x) + JENT_COLLECTOR_ALIGN - 1) & ~(size_t)(JENT_COLLECTOR_ALIGN - 1))
+#define JENT_COLLECTOR_HASH_OFFSET					      \
+	JENT_COLLECTOR_ROUNDUP(sizeof(struct rand_data))
+#define JENT_COLLECTOR_MEM_OFFSET					      \
+	(JENT_COLLECTOR_HASH_OFFSET + JENT_COLLECTOR_ROUNDUP(JENT_SHA_MAX_CTX_SIZE))
+
+/*
+ * Bind all memory of the collector to @node: its state with the hash state
+ * behind it and the memory access region unless it is shared. In caller
+ * memory that is the pages entirely inside the buffer.
+ */
+static int jent_collector_bind(struct rand_data *ec, int node)
+{
+	int ret;
+
+	if (ec->placed_len) {
+		ret = jent_memory_bind_node(ec, ec->placed_len, node);
+		if (ret)
+			return ret;
+
+		ec->numa_node = node;
+		return 0;
+	}
+
+	ret = jent_memory_bind_alloc(ec, JENT_COLLECTOR_MEM_OFFSET, node);
+	if (ret)
+		return ret;
+
+	/* A shared region stays on the node it was allocated for */
+	if (ec->mem && !ec->shared_mem) {
+		ret = jent_memory_bind_alloc(ec->mem, ec->memmask + 1, node);
+		if (ret)
+			return ret;
+	}
+
+	ec->numa_node = node;
+
+	return 0;
+}
+
 JENT_PRIVATE_STATIC
-ssize_t jent_read_entropy(struct rand_data *ec, char *data, size_t len)
+int jent_entropy_collector_bind_node(struct rand_data *ec, int node)
+{
+	if (!ec || node < -1)
+		return -EINVAL;
+
+	/* The node of the CPU the caller runs on */
+	if (node == -1) {
+		node = jent_memory_local_node();
+		if (node < 0)
+			return -EOPNOTSUPP;
+	}
+
+	return jent_collector_bind(ec, node);
+}
+
+/*
+ * Map the result of jent_health_failure() to the error code returned to the
+ * caller, the permanent failures first.
+ */
+static int jent_health_error(unsigned int health_test_result)
+{
+	if (health_test_result & JENT_RCT_FAILURE_PERMANENT)
+		return JENT_ERR_RCT_PERMANENT;
+	if (health_test_result & JENT_APT_FAILURE_PERMANENT)
+		return JENT_ERR_APT_PERMANENT;
+	if (health_test_result & JENT_LAG_FAILURE_PERMANENT)
+		return JENT_ERR_LAG_PERMANENT;
+	if (health_test_result & JENT_RCT_MEM_FAILURE_PERMANENT)
+		return JENT_ERR_RCT_MEM_PERMANENT;
+	if (health_test_result & JENT_SCHED_RCT_FAILURE_PERMANENT)
+		return JENT_ERR_SCHED_RCT_PERMANENT;
+	if (health_test_result & JENT_SCHED_APT_FAILURE_PERMANENT)
+		return JENT_ERR_SCHED_APT_PERMANENT;
+	if (health_test_result & JENT_RCT_FAILURE)
+		return JENT_ERR_RCT;
+	if (health_test_result & JENT_APT_FAILURE)
+		return JENT_ERR_APT;
+	if (health_test_result & JENT_RCT_MEM_FAILURE)
+		return JENT_ERR_RCT_MEM;
+	if (health_test_result & JENT_SCHED_RCT_FAILURE)
+		return JENT_ERR_SCHED_RCT;
+	if (health_test_result & JENT_SCHED_APT_FAILURE)
+		return JENT_ERR_SCHED_APT;
+
+	/*
+	 * The only remaining defined bit is JENT_LAG_FAILURE. A hypothetical
+	 * unknown bit lands here as well: a health test failure must never
+	 * result in a success return.
+	 */
+	return JENT_ERR_LAG;
+}
+
+/*
+ * Tell a collector fork() copied into this process apart from its parent,
+ * before the collector generates output in the child.
+ */
+static void jent_fork_rekey(struct rand_data *ec)
+{
+	uint32_t fork_generation;
+
+	/*
+	 * fork() copied the collector into this process, together with the
+	 * XDRBG state the parent and every other child hold as well. A block
+	 * completed or begun before the fork() is dropped: its samples are the
+	 * same in every copy, and only a new block collected here absorbs
+	 * jitter of this process before the XDRBG generates from the state.
+	 * The copy is told apart before that block all the same: the fork
+	 * generation and a time stamp of the child enter its reseed, whose
+	 * generate ratchets the state past them. That costs nothing next to
+	 * the new collector and startup a child would otherwise allocate. The
+	 * copy is a collector of its own from then on, with an identifier of
+	 * its own.
+	 */
+	fork_generation = jent_fork_generation();
+	if (ec->fork_generation != fork_generation) {
+		uint64_t fork_seed[2];
+
+		fork_seed[0] = fork_generation;
+		jent_get_nstime_internal(ec, &fork_seed[1]);
+		jent_sha3_update(ec->hash_state, (uint8_t *)fork_seed,
+				 sizeof(fork_seed));
+		jent_uuid_generate(ec->uuid);
+		ec->fork_generation = fork_generation;
+		ec->fork_rekeys++;
+
+		ec->block_ready = 0;
+		ec->block_samples = 0;
+		ec->block_interrupted = 0;
+	}
+}
+
+/* The sink of jent_read_entropy_stream() as a consumer of the XDRBG */
+struct jent_sink_ctx {
+	jent_read_entropy_sink sink;
+	void *ctx;
+};
+
+static int jent_sink_out(void *ctx, const uint8_t *data, size_t len)
+{
+	struct jent_sink_ctx *out = ctx;
+
+	return out->sink(out->ctx, (const char *)data, len);
+}
+
+/*
+ * jent_read_entropy_iov() and, with timed set, jent_read_entropy_timed(): no
+ * block is started or continued once budget has passed since the call began.
+ * With a sink, the blocks go to it instead of into the buffers, whose
+ * iov_base is then NULL and only iov_len counts.
+ */
+static ssize_t jent_read_entropy_until(struct rand_data *ec,
+				       const struct jent_iovec *iov,
+				       unsigned int iovcnt,
+				       jent_read_entropy_sink sink, void *ctx,
+				       int timed, uint64_t budget)
 {
 	/*
 	 * Maximum value representable by ssize_t. Use a portable definition
@@ -272,31 +481,80 @@ ssize_t jent_read_entropy(struct rand_data *ec, char *data, size_t len)
 	 * would be undefined behavior as soon as ssize_t is the wider type.
 	 */
 	static const size_t ssize_max = (size_t)-1 >> 1;
-	char *p = data;
-	size_t orig_len;
-	int ret = 0;
+	char *p = NULL;
+	struct jent_sink_ctx out;
+	size_t len = 0, done = 0, avail = ssize_max;
+	uint64_t start = 0, end = 0, now;
+	unsigned int i;
+	int ret = 0, timed_block, stop;
 
 	JENT_BUILD_BUG_ON(sizeof(ssize_t) != sizeof(size_t));
 
 	/* check obvious misuse of API */
-	if (!ec || (data == NULL && len > 0))
+	if (!ec || (iov == NULL && iovcnt > 0))
 		return JENT_ERR_EINVAL;
+	for (i = 0; i < iovcnt; i++) {
+		if (!sink && iov[i].iov_base == NULL && iov[i].iov_len > 0)
+			return JENT_ERR_EINVAL;
+	}
 
-	/*
-	 * (hypothetical) edge case: clamp to ssize_t range to prevent
-	 * negative return on cast
-	 */
-	if (len > ssize_max)
-		len = ssize_max;
-	orig_len = len;
+	/* No output before the startup of a deferred collector completed */
+	if (ec->starting)
+		return JENT_ERR_STARTING;
+
+	out.sink = sink;
+	out.ctx = ctx;
 
 	if (jent_notime_settick(ec))
 		return JENT_ERR_NOTIME;
 
-	while (len > 0) {
+	jent_fork_rekey(ec);
+
+	/*
+	 * The deadline is checked between the samples of a block, on the time
+	 * stamps the noise source takes anyway, and before a further block.
+	 * A call takes at least one sample, so that a block in progress
+	 * completes over enough calls whatever the budget.
+	 */
+	if (timed) {
+		jent_get_nstime_internal(ec, &now);
+		ec->read_deadline = now + budget;
+		if (ec->read_deadline < now)
+			ec->read_deadline = (uint64_t)-1;
+	}
+
+	i = 0;
+	for (;;) {
 		size_t tocopy;
 		unsigned int health_test_result;
 
+		/*
+		 * Move on to the next buffer. No block is split between two
+		 * buffers: each receives blocks of its own, as from a call of
+		 * its own, while the timer and the fork check above serve the
+		 * whole request.
+		 */
+		if (!len) {
+			if (i == iovcnt)
+				break;
+			p = iov[i].iov_base;
+			len = iov[i].iov_len;
+			i++;
+
+			/*
+			 * (hypothetical) edge case: clamp to ssize_t range to
+			 * prevent negative return on cast
+			 */
+			if (len > avail)
+				len = avail;
+			avail -= len;
+			continue;
+		}
+
+		if (ec->read_deadline && done &&
+		    ec->prev_time >= ec->read_deadline)
+			break;
+
 		/*
 		 * A conditioning self test bound to this instance failed. The
 		 * check does not go through jent_health_failure(): that path
@@ -311,36 +569,37 @@ ssize_t jent_read_entropy(struct rand_data *ec, char *data, size_t len)
 			goto err;
 		}
 
-		jent_random_data(ec);
-
-		if ((health_test_result = jent_health_failure(ec))) {
-			if (health_test_result & JENT_RCT_FAILURE_PERMANENT)
-				ret = JENT_ERR_RCT_PERMANENT;
-			else if (health_test_result &
-				 JENT_APT_FAILURE_PERMANENT)
-				ret = JENT_ERR_APT_PERMANENT;
-			else if (health_test_result &
-				 JENT_LAG_FAILURE_PERMANENT)
-				ret = JENT_ERR_LAG_PERMANENT;
-			else if (health_test_result &
-				 JENT_RCT_MEM_FAILURE_PERMANENT)
-				ret = JENT_ERR_RCT_MEM_PERMANENT;
-			else if (health_test_result & JENT_RCT_FAILURE)
-				ret = JENT_ERR_RCT;
-			else if (health_test_result & JENT_APT_FAILURE)
-				ret = JENT_ERR_APT;
-			else if (health_test_result & JENT_RCT_MEM_FAILURE)
-				ret = JENT_ERR_RCT_MEM;
-			else
-				/*
-				 * The only remaining defined bit is
-				 * JENT_LAG_FAILURE. A hypothetical unknown bit
-				 * lands here as well: a health test failure
-				 * must never result in a success return.
-				 */
-				ret = JENT_ERR_LAG;
+		if (ec->block_ready) {
+			/*
+			 * jent_entropy_step() completed the block and ran its
+			 * health test already: it is used first.
+			 */
+			ec->block_ready = 0;
+		} else {
+			/* A block continued from an earlier call is not timed */
+			timed_block = ec->latency_target && !ec->block_samples;
+			if (timed_block)
+				jent_get_nstime_internal(ec, &start);
 
-			goto err;
+			jent_random_data(ec);
+
+			if ((health_test_result = jent_health_failure(ec))) {
+				ret = jent_health_error(health_test_result);
+				goto err;
+			}
+
+			/*
+			 * The deadline interrupted the block, its samples are
+			 * kept. Not told by the sample count, which is 0 as
+			 * well when the samples of the block were all stuck.
+			 */
+			if (ec->block_interrupted)
+				break;
+
+			if (timed_block) {
+				jent_get_nstime_internal(ec, &end);
+				jent_latency_control(ec, end - start);
+			}
 		}
 
 		if ((DATA_SIZE_BITS / 8) < len)
@@ -348,10 +607,29 @@ ssize_t jent_read_entropy(struct rand_data *ec, char *data, size_t len)
 		else
 			tocopy = len;
 
+		if (sink) {
+			/*
+			 * The block is handed over where the XDRBG generates
+			 * it, which wipes it before the next one. Output
+			 * handed to the sink counts as delivered, whatever it
+			 * returns.
+			 */
+			stop = jent_read_random_block_out(ec, tocopy,
+							  jent_sink_out, &out);
+			ec->adaptive_clean_blocks++;
+			len -= tocopy;
+			done += tocopy;
+			if (stop)
+				break;
+			continue;
+		}
+
 		jent_read_random_block(ec, p, tocopy);
+		ec->adaptive_clean_blocks++;
 
 		len -= tocopy;
 		p += tocopy;
+		done += tocopy;
 	}
 
 	/*
@@ -368,16 +646,445 @@ ssize_t jent_read_entropy(struct rand_data *ec, char *data, size_t len)
 	 * retained pool state allowed the last output to be recomputed.
 	 */
 
-err:
-	jent_notime_unsettick(ec);
+err:
+	jent_notime_unsettick(ec);
+	ec->read_deadline = 0;
+
+	/*
+	 * Count only the bytes actually delivered to the caller, which a
+	 * deadline may leave short of the request.
+	 */
+	if (!ret) {
+		ec->read_invocations++;
+		ec->bytes_output += done;
+	} else {
+		/* The clean window of JENT_ADAPTIVE_OSR starts over. */
+		ec->adaptive_clean_blocks = 0;
+
+		/* A reduced configuration is not kept once a test failed. */
+		if (ec->latency_target)
+			jent_latency_restore(ec);
+	}
+
+	return ret ? ret : (ssize_t)done;
+}
+
+/**
+ * Entry function: Obtain entropy for the caller.
+ *
+ * This function invokes the entropy gathering logic as often to generate
+ * as many bytes as requested by the caller. The entropy gathering logic
+ * creates 64 bit per invocation.
+ *
+ * This function truncates the last 64 bit entropy value output to the exact
+ * size specified by the caller.
+ *
+ * @param[in] ec Reference to entropy collector
+ * @param[out] data pointer to buffer for storing random data -- buffer must
+ *	       already exist
+ * @param[in] len size of the buffer, specifying also the requested number of random
+ *	     in bytes
+ *
+ * @return number of bytes returned when request is fulfilled or an error
+ *
+ * The following error codes can occur:
+ *	JENT_ERR_EINVAL			(-1)  entropy_collector is NULL
+ *	JENT_ERR_RCT			(-2)  RCT failed
+ *	JENT_ERR_APT			(-3)  APT failed
+ *	JENT_ERR_NOTIME			(-4)  The timer cannot be initialized
+ *	JENT_ERR_LAG			(-5)  LAG failure
+ *	JENT_ERR_RCT_PERMANENT		(-6)  RCT permanent failure
+ *	JENT_ERR_APT_PERMANENT		(-7)  APT permanent failure
+ *	JENT_ERR_LAG_PERMANENT		(-8)  LAG permanent failure
+ *	JENT_ERR_RCT_MEM		(-9)  RCT with memory failed
+ *	JENT_ERR_RCT_MEM_PERMANENT	(-10) RCT with memory permanent failure
+ *	JENT_ERR_SELFTEST		(-11) A bound jent_selftest run failed,
+ *					      permanently
+ *	JENT_ERR_STARTING		(-12) The deferred startup has not
+ *					      completed yet
+ *	JENT_ERR_SCHED_RCT		(-13) Scheduling RCT failed
+ *	JENT_ERR_SCHED_APT		(-14) Scheduling APT failed
+ *	JENT_ERR_SCHED_RCT_PERMANENT	(-15) Scheduling RCT permanent failure
+ *	JENT_ERR_SCHED_APT_PERMANENT	(-16) Scheduling APT permanent failure
+ */
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy(struct rand_data *ec, char *data, size_t len)
+{
+	struct jent_iovec iov;
+
+	iov.iov_base = data;
+	iov.iov_len = len;
+	return jent_read_entropy_until(ec, &iov, 1, NULL, NULL, 0, 0);
+}
+
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_timed(struct rand_data *ec, char *data, size_t len,
+				uint64_t budget)
+{
+	struct jent_iovec iov;
+
+	iov.iov_base = data;
+	iov.iov_len = len;
+	return jent_read_entropy_until(ec, &iov, 1, NULL, NULL, 1, budget);
+}
+
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_iov(struct rand_data *ec,
+			      const struct jent_iovec *iov,
+			      unsigned int iovcnt)
+{
+	return jent_read_entropy_until(ec, iov, iovcnt, NULL, NULL, 0, 0);
+}
+
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_stream(struct rand_data *ec, size_t len,
+				 jent_read_entropy_sink sink, void *ctx)
+{
+	struct jent_iovec iov;
+
+	if (!sink)
+		return JENT_ERR_EINVAL;
+
+	iov.iov_base = NULL;
+	iov.iov_len = len;
+	return jent_read_entropy_until(ec, &iov, 1, sink, ctx, 0, 0);
+}
+
+JENT_PRIVATE_STATIC
+int jent_entropy_step(struct rand_data *ec, unsigned int samples)
+{
+	unsigned int health_test_result;
+
+	if (!ec || !samples)
+		return JENT_ERR_EINVAL;
+
+	if (ec->starting)
+		return JENT_ERR_STARTING;
+
+	if (ec->selftest_failed)
+		return JENT_ERR_SELFTEST;
+
+	if (jent_notime_settick(ec))
+		return JENT_ERR_NOTIME;
+
+	/* A block waiting from before a fork() is dropped here */
+	jent_fork_rekey(ec);
+
+	/* The block waits for jent_read_entropy_step() */
+	if (ec->block_ready) {
+		jent_notime_unsettick(ec);
+		return 1;
+	}
+
+	/*
+	 * The block continues where the last step, or a deadline of
+	 * jent_read_entropy_timed(), left it. Its health tests run on every
+	 * sample as in a read, and a failure is reported by the step that
+	 * takes the sample.
+	 */
+	ec->step_samples = samples;
+	jent_random_data(ec);
+	ec->step_samples = 0;
+
+	jent_notime_unsettick(ec);
+
+	if ((health_test_result = jent_health_failure(ec))) {
+		ec->adaptive_clean_blocks = 0;
+		if (ec->latency_target)
+			jent_latency_restore(ec);
+		return jent_health_error(health_test_result);
+	}
+
+	if (ec->block_interrupted)
+		return 0;
+
+	ec->block_ready = 1;
+	return 1;
+}
+
+JENT_PRIVATE_STATIC
+ssize_t jent_read_entropy_step(struct rand_data *ec, char *data, size_t len)
+{
+	if (!ec || (data == NULL && len > 0))
+		return JENT_ERR_EINVAL;
+
+	if (ec->selftest_failed)
+		return JENT_ERR_SELFTEST;
+
+	if (!ec->block_ready)
+		return 0;
+
+	if ((DATA_SIZE_BITS / 8) < len)
+		len = (DATA_SIZE_BITS / 8);
+
+	/*
+	 * The block may have been completed before a fork(), which drops it:
+	 * the child collects one of its own with jent_entropy_step().
+	 */
+	if (jent_notime_settick(ec))
+		return JENT_ERR_NOTIME;
+	jent_fork_rekey(ec);
+	jent_notime_unsettick(ec);
+	if (!ec->block_ready)
+		return 0;
+
+	jent_read_random_block(ec, data, len);
+	ec->block_ready = 0;
+	ec->adaptive_clean_blocks++;
+	ec->read_invocations++;
+	ec->bytes_output += len;
+
+	return (ssize_t)len;
+}
+
+/*
+ * Carry the identity of a collector over to the one that replaces it: whether
+ * the caller configured the memory size, the instance identifier (empty during
+ * the startup-time reset, when it has not been assigned yet), the lifetime
+ * accounting and the state of the adaptive oversampling rate. The
+ * reinitialization is counted.
+ *
+ * The health test state is not part of it - whether it continues is the
+ * caller's decision, see jent_health_failure_reset().
+ */
+static void jent_collector_carry_over(struct rand_data *new_ec,
+				      const struct rand_data *old_ec)
+{
+	/* Remember whether caller configured memory size */
+	new_ec->max_mem_set = !!old_ec->max_mem_set;
+
+	memcpy(new_ec->uuid, old_ec->uuid, sizeof(new_ec->uuid));
+	new_ec->reinit_count = old_ec->reinit_count + 1;
+	new_ec->fork_rekeys = old_ec->fork_rekeys;
+
+	new_ec->recovery_osr = old_ec->recovery_osr;
+	new_ec->recovery_flags = old_ec->recovery_flags;
+	new_ec->recovery_candidates = old_ec->recovery_candidates;
+	new_ec->recovery_width = old_ec->recovery_width;
+
+	/* Preserve the lifetime output accounting across the reallocation. */
+	new_ec->read_invocations = old_ec->read_invocations;
+	new_ec->bytes_output = old_ec->bytes_output;
+
+	new_ec->osr_floor = old_ec->osr_floor;
+	new_ec->flags_floor = old_ec->flags_floor;
+	new_ec->adaptive_window = old_ec->adaptive_window;
+	new_ec->adaptive_step_downs = old_ec->adaptive_step_downs;
+
+	new_ec->latency_target = old_ec->latency_target;
+	new_ec->latency_reductions = old_ec->latency_reductions;
+	new_ec->latency_restorations = old_ec->latency_restorations;
+
+	/* The binding is best effort here, the old placement is no loss */
+	if (old_ec->numa_node >= 0)
+		jent_collector_bind(new_ec, old_ec->numa_node);
+}
+
+/* Double the clean window required before the next step down probe. */
+static void jent_adaptive_osr_backoff(struct rand_data *ec)
+{
+	if (!(ec->flags & JENT_ADAPTIVE_OSR))
+		return;
+
+	ec->adaptive_window <<= 1;
+	if (ec->adaptive_window > JENT_ADAPTIVE_OSR_WINDOW_MAX)
+		ec->adaptive_window = JENT_ADAPTIVE_OSR_WINDOW_MAX;
+}
+
+static int jent_entropy_init_internal(unsigned int osr, unsigned int flags,
+				      int record);
+
+/*
+ * One rung of the OSR ladder searched by jent_osr_ladder_search(): the
+ * configuration handed to the power-up test and the verdict it returned.
+ */
+struct jent_osr_candidate {
+	void *worker;		/* thread evaluating it, NULL if inline */
+	unsigned int osr;
+	unsigned int flags;
+	int ret;		/* jent_entropy_init_ex() result */
+};
+
+/*
+ * Number of adjacent OSR values the recovery puts through the power-up test at
+ * the same time. Each of them costs a CPU - two with the internal timer - for
+ * the duration of one jent_entropy_init_ex(), so the width actually used is
+ * further bounded by what the machine offers, see jent_osr_ladder_width().
+ */
+#define JENT_OSR_LADDER_WIDTH 4
+
+static unsigned int jent_osr_ladder_width(unsigned int flags)
+{
+#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
+	long ncpu = jent_ncpu();
+	unsigned long width;
+
+	if (ncpu < 2)
+		return 1;
+
+	width = (unsigned long)ncpu;
+
+	/* The power-up test of such a candidate runs its own counting thread */
+	if (jent_notime_forced() || (flags & JENT_FORCE_INTERNAL_TIMER))
+		width /= 2;
+
+	if (width > JENT_OSR_LADDER_WIDTH)
+		width = JENT_OSR_LADDER_WIDTH;
+
+	return width ? (unsigned int)width : 1;
+#else
+	(void)flags;
+	return 1;
+#endif
+}
+
+#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
+#ifdef JENT_PTHREAD
+static void *jent_osr_ladder_worker(void *arg)
+#else
+static int jent_osr_ladder_worker(void *arg)
+#endif
+{
+	struct jent_osr_candidate *c = (struct jent_osr_candidate *)arg;
+
+	c->ret = jent_entropy_init_internal(c->osr, c->flags, 0);
+
+#ifdef JENT_PTHREAD
+	return NULL;
+#else
+	return 0;
+#endif
+}
+#endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
+
+/*
+ * Find the lowest OSR at or above *osr for which the power-up test passes with
+ * the given flags.
+ *
+ * The sequential search runs one complete jent_entropy_init_ex() per rung,
+ * which on a host that keeps failing adds up to JENT_MAX_OSR - JENT_MIN_OSR
+ * power-up tests back to back. Instead, the next width rungs are tested at
+ * once: the lowest one on the calling thread, the others on worker threads.
+ * The verdicts are then taken in ascending order, so the outcome is the same
+ * the sequential search would arrive at - only the wall clock time is bounded
+ * by the number of rounds rather than the number of rungs.
+ *
+ * That holds for the hardware timer only. jent_entropy_init_ex() falls back
+ * to the internal timer when the hardware timer fails, and reaching that
+ * fallback calls the one-way, process-wide jent_notime_force(), after which no
+ * collector disabling the internal timer can be allocated any more. The
+ * sequential search only gets there on a rung all lower rungs failed, so the
+ * rungs are tested concurrently with the internal timer disabled, and the
+ * fallback is tried on the calling thread, rung by rung in ascending order,
+ * for a rung whose hardware timer failed once all lower rungs are known to
+ * have failed.
+ *
+ * The concurrent tests load the machine while they measure it. That does not
+ * make a candidate pass that would fail on its own on a quiet machine any more
+ * than a busy co-tenant does during the sequential search: the chosen
+ * configuration has to pass the startup and runtime health tests of the
+ * collector allocated with it like any other.
+ *
+ * A rung whose worker cannot be started is tested inline once the lower ones
+ * are known to have failed, which is also the sequential search a build
+ * without a thread handler or a single CPU gets.
+ *
+ * The rungs differ in the OSR only. The memory size and hash loop count are
+ * raised one step by the recovery before the search, as they always were:
+ * candidates differing in those as well would have no order against a higher
+ * OSR for "the lowest passing configuration" to follow, and would multiply
+ * the power-up tests run per rung without a CPU more to run them on.
+ *
+ * A rung does not record its verdict as that of the process self tests, see
+ * jent_entropy_init_internal().
+ *
+ * @return 0 with *osr updated, -1 if no OSR up to JENT_MAX_OSR passes
+ */
+static int jent_osr_ladder_search(unsigned int *osr, unsigned int flags,
+				  unsigned int *candidates,
+				  unsigned int *width_used)
+{
+	struct jent_osr_candidate cand[JENT_OSR_LADDER_WIDTH];
+	unsigned int width = jent_osr_ladder_width(flags);
+	unsigned int base = *osr, hw_flags = flags, notime_fallback = 0;
+
+	/* The configurations jent_entropy_init_ex() falls back for */
+	if (!(flags & (JENT_FORCE_INTERNAL_TIMER | JENT_DISABLE_INTERNAL_TIMER |
+		       JENT_NTG1))) {
+		hw_flags |= JENT_DISABLE_INTERNAL_TIMER;
+#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
+		notime_fallback = 1;
+#endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
+	}
+
+	*candidates = 0;
+	*width_used = 1;
+
+	while (base <= JENT_MAX_OSR) {
+		unsigned int i, n = JENT_MAX_OSR - base + 1, found = 0;
+		unsigned int running = 1;
+
+		if (n > width)
+			n = width;
+
+		for (i = 0; i < n; i++) {
+			cand[i].worker = NULL;
+			cand[i].osr = base + i;
+			cand[i].flags = hw_flags;
+			cand[i].ret = ENOTIME;
+
+#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
+			/* The lowest rung is always tested by the caller */
+			if (i && !jent_notime_worker_start(
+					&cand[i].worker, jent_osr_ladder_worker,
+					&cand[i], hw_flags))
+				running++;
+#endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
+		}
+
+		if (running > *width_used)
+			*width_used = running;
 
-	/* Count only the bytes actually delivered to the caller. */
-	if (!ret) {
-		ec->read_invocations++;
-		ec->bytes_output += orig_len;
+		cand[0].ret = jent_entropy_init_internal(cand[0].osr, hw_flags,
+							 0);
+		(*candidates)++;
+
+		for (i = 0; i < n; i++) {
+			if (cand[i].worker) {
+#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
+				jent_notime_worker_join(cand[i].worker);
+#endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
+				cand[i].worker = NULL;
+				(*candidates)++;
+			} else if (i && !found) {
+				/* No worker and no lower rung passed */
+				cand[i].ret = jent_entropy_init_internal(
+					cand[i].osr, hw_flags, 0);
+				(*candidates)++;
+			}
+
+			/* All lower rungs failed: the internal timer is next */
+			if (!found && cand[i].ret && notime_fallback) {
+				cand[i].ret = jent_entropy_init_internal(
+					cand[i].osr,
+					flags | JENT_FORCE_INTERNAL_TIMER, 0);
+				(*candidates)++;
+			}
+
+			/* Continue joining the workers above the result */
+			if (!found && !cand[i].ret) {
+				*osr = cand[i].osr;
+				found = 1;
+			}
+		}
+
+		if (found)
+			return 0;
+
+		base += n;
 	}
 
-	return ret ? ret : (ssize_t)orig_len;
+	return -1;
 }
 
 static int jent_health_failure_reset(
@@ -385,7 +1092,11 @@ static int jent_health_failure_reset(
 							  unsigned int flags))
 {
 	struct rand_data *new_ec;
-	unsigned int osr, flags;
+	unsigned int osr, flags, candidates, width;
+
+	/* The caller memory of a collector is sized for its configuration */
+	if ((*ec)->placed_len)
+		return -1;
 
 	/* Increment OSR */
 	osr = (*ec)->osr + 1;
@@ -408,11 +1119,8 @@ static int jent_health_failure_reset(
 	flags = jent_update_hashloop(flags, 1);
 
 	/* Perform new health test with updated OSR */
-	while (jent_entropy_init_ex(osr, flags)) {
-		osr++;
-		if (osr > JENT_MAX_OSR)
-			return -1;
-	}
+	if (jent_osr_ladder_search(&osr, flags, &candidates, &width))
+		return -1;
 
 	new_ec = alloc(osr, flags);
 
@@ -423,9 +1131,6 @@ static int jent_health_failure_reset(
 	if (!new_ec)
 		return -1;
 
-	/* Remember whether caller configured memory size */
-	new_ec->max_mem_set = !!(*ec)->max_mem_set;
-
 	/*
 	 * Duplicate the state of the health tests to ensure the newly allocated
 	 * state will continue from the current health state.
@@ -435,17 +1140,16 @@ static int jent_health_failure_reset(
 	jent_lag_duplicate(new_ec, *ec);
 	jent_rct_mem_duplicate(new_ec, *ec);
 
-	/*
-	 * Carry the instance identifier over so the reallocated collector keeps
-	 * the same UUID (empty during the startup-time reset, when it has not
-	 * been assigned yet), and count this reinitialization.
-	 */
-	memcpy(new_ec->uuid, (*ec)->uuid, sizeof(new_ec->uuid));
-	new_ec->reinit_count = (*ec)->reinit_count + 1;
+	jent_collector_carry_over(new_ec, *ec);
 
-	/* Preserve the lifetime output accounting across the reallocation. */
-	new_ec->read_invocations = (*ec)->read_invocations;
-	new_ec->bytes_output = (*ec)->bytes_output;
+	/* Record what the ladder search settled on for jent_status(). */
+	new_ec->recovery_osr = new_ec->osr;
+	new_ec->recovery_flags = new_ec->flags;
+	new_ec->recovery_candidates = candidates;
+	new_ec->recovery_width = width;
+
+	/* A host that needed the recovery is probed less eagerly. */
+	jent_adaptive_osr_backoff(new_ec);
 
 	jent_entropy_collector_free(*ec);
 	*ec = new_ec;
@@ -456,6 +1160,89 @@ static int jent_health_failure_reset(
 static struct rand_data *_jent_entropy_collector_alloc(unsigned int osr,
 						       unsigned int flags);
 
+/*
+ * Lower the memory size and hash loop fields of the flags by the one step a
+ * recovery raises them by, but not below the fields of the floor.
+ */
+static unsigned int jent_adaptive_osr_flags(unsigned int flags,
+					    unsigned int floor)
+{
+	unsigned int mem = JENT_FLAGS_TO_MAX_MEMSIZE(flags);
+	unsigned int hashloop = JENT_FLAGS_TO_HASHLOOP(flags);
+
+	if (mem > JENT_FLAGS_TO_MAX_MEMSIZE(floor))
+		mem--;
+	if (hashloop > JENT_FLAGS_TO_HASHLOOP(floor))
+		hashloop--;
+
+	flags &= ~(JENT_MAX_MEMSIZE_MASK | (unsigned int)JENT_MAX_HASHLOOP_MASK);
+	flags |= JENT_MAX_MEMSIZE_TO_FLAGS(mem) | JENT_HASHLOOP_TO_FLAGS(hashloop);
+
+	return flags;
+}
+
+/*
+ * JENT_ADAPTIVE_OSR: once a collector that a recovery raised above the
+ * configuration it was allocated with has generated a window of blocks without
+ * a health test failure, probe the configuration one step below - the inverse
+ * of the step jent_health_failure_reset() takes - with the full power-up test
+ * and, if it passes, replace the collector with one allocated at it.
+ *
+ * The replacement runs through the complete startup like every allocation. Its
+ * health tests start afresh rather than from the duplicated state a recovery
+ * hands over: that duplication primes the new collector as if it had just
+ * failed, which is the opposite of what a clean window established.
+ *
+ * Nothing here is an error to the caller. A probe that fails leaves the
+ * collector as it is and doubles the window before the next one.
+ */
+static void jent_adaptive_osr_step_down(struct rand_data **ec)
+{
+	struct rand_data *new_ec;
+	unsigned int osr, flags;
+
+	if (!((*ec)->flags & JENT_ADAPTIVE_OSR))
+		return;
+
+	if ((*ec)->adaptive_clean_blocks < (*ec)->adaptive_window)
+		return;
+	(*ec)->adaptive_clean_blocks = 0;
+
+	/* Never below the configured floor */
+	if ((*ec)->osr <= (*ec)->osr_floor)
+		return;
+
+	osr = (*ec)->osr - 1;
+	flags = jent_adaptive_osr_flags((*ec)->flags, (*ec)->flags_floor);
+
+	if (jent_entropy_init_ex(osr, flags)) {
+		jent_adaptive_osr_backoff(*ec);
+		return;
+	}
+
+	new_ec = _jent_entropy_collector_alloc(osr, flags);
+	if (!new_ec) {
+		jent_adaptive_osr_backoff(*ec);
+		return;
+	}
+
+	/*
+	 * The startup of the replacement may itself have recovered upwards,
+	 * in which case there is nothing gained by switching over.
+	 */
+	if (new_ec->osr >= (*ec)->osr) {
+		jent_entropy_collector_free(new_ec);
+		jent_adaptive_osr_backoff(*ec);
+		return;
+	}
+
+	jent_collector_carry_over(new_ec, *ec);
+	new_ec->adaptive_step_downs++;
+
+	jent_entropy_collector_free(*ec);
+	*ec = new_ec;
+}
+
 /**
  * Entry function: Obtain entropy for the caller.
  *
@@ -470,6 +1257,11 @@ static struct rand_data *_jent_entropy_collector_alloc(unsigned int osr,
  * getting too large. If an error is returned by this function, the Jitter RNG
  * is not safe to be used on the current system.
  *
+ * With JENT_ADAPTIVE_OSR, the function also takes the way back: after a clean
+ * window of output it re-allocates the entropy collector one step below the
+ * raised configuration if that passes the power-up health test, see
+ * jent_adaptive_osr_step_down().
+ *
  * @param[in] ec Reference to entropy collector - this is a double pointer as
  *	    	 The entropy collector may be freed and reallocated.
  * @param[out] data pointer to buffer for storing random data -- buffer must
@@ -511,6 +1303,13 @@ ssize_t jent_read_entropy_safe(struct rand_data **ec, char *data, size_t len)
 		len = ssize_max;
 	orig_len = len;
 
+	/* Wait for the startup of a deferred collector */
+	do {
+		ret = jent_entropy_collector_start(ec);
+	} while (ret == JENT_ERR_STARTING);
+	if (ret)
+		return ret;
+
 	while (len > 0) {
 		ret = jent_read_entropy(*ec, p, len);
 
@@ -524,6 +1323,8 @@ ssize_t jent_read_entropy_safe(struct rand_data **ec, char *data, size_t len)
 		case JENT_ERR_APT_PERMANENT:
 		case JENT_ERR_LAG_PERMANENT:
 		case JENT_ERR_RCT_MEM_PERMANENT:
+		case JENT_ERR_SCHED_RCT_PERMANENT:
+		case JENT_ERR_SCHED_APT_PERMANENT:
 
 			/*
 			 * A failed conditioning self test as well: it judges
@@ -538,6 +1339,8 @@ ssize_t jent_read_entropy_safe(struct rand_data **ec, char *data, size_t len)
 		case JENT_ERR_APT:
 		case JENT_ERR_LAG:
 		case JENT_ERR_RCT_MEM:
+		case JENT_ERR_SCHED_RCT:
+		case JENT_ERR_SCHED_APT:
 			/*
 			 * Re-allocate the entropy collector with updated
 			 * OSR, hash loop count and memory size and run
@@ -562,6 +1365,8 @@ ssize_t jent_read_entropy_safe(struct rand_data **ec, char *data, size_t len)
 			if (ret >= 0) {
 				len -= (size_t)ret;
 				p += (size_t)ret;
+
+				jent_adaptive_osr_step_down(ec);
 			} else {
 				return JENT_ERR_EINVAL;
 			}
@@ -624,11 +1429,177 @@ unsigned int jent_hashloop_cnt(unsigned int flags)
  */
 static int jent_selftest_run = 0;
 
+/*
+ * Size of a collector in caller memory, the layout above followed by the memory
+ * access region, for flags the memory size is not yet derived in
+ */
+static size_t jent_collector_placed_size(unsigned int flags)
+{
+	if (flags & JENT_DISABLE_MEMORY_ACCESS)
+		return JENT_COLLECTOR_MEM_OFFSET;
+
+	return JENT_COLLECTOR_MEM_OFFSET + jent_memsize(jent_update_memsize(flags, 0));
+}
+
+/*
+ * JENT_SHARED_MEMORY: memory access regions shared by collectors. The noise
+ * source times the accesses, the values it stores are never read back into
+ * the entropy pool, so a region holds nothing secret and can serve every
+ * collector of its size. Collectors allocated on the same NUMA node share one,
+ * which keeps the memory footprint a matter of nodes and sizes rather than of
+ * collectors.
+ */
+struct jent_shared_mem {
+	struct jent_shared_mem *next;
+	unsigned char *mem;
+	uint32_t memsize;
+	unsigned int flags;	/* The allocation flags of mem */
+	int node;		/* -1 where the node is not known */
+	unsigned int users;
+	unsigned int attached;	/* Collectors ever attached, for the offsets */
+};
+
+/* Allocation flags a region is looked up by */
+#define JENT_SHARED_MEM_FLAGS	(JENT_HUGE_PAGES | JENT_FORCE_SECURE_MEM)
+
+/*
+ * Fibonacci hashing of the attachment count spreads the starting offsets of
+ * the collectors of a region evenly, whatever their number.
+ */
+#define JENT_SHARED_MEM_SPREAD	0x9e3779b9U
+
+static struct jent_shared_mem *jent_shared_mems;
+
+/*
+ * Guards jent_shared_mems. Regions are allocated and freed outside of it,
+ * jent_zalloc() may take a lock of its own. A fork() waits for it, see
+ * jent_fork_guard().
+ */
+static int jent_shared_mems_locked;
+
+static void jent_shared_mem_lock(void)
+{
+	jent_fork_guard(&jent_shared_mems_locked);
+	while (jent_atomic_exchange_int(&jent_shared_mems_locked, 1))
+		;
+}
+
+static void jent_shared_mem_unlock(void)
+{
+	jent_atomic_store_int(&jent_shared_mems_locked, 0);
+}
+
+static struct jent_shared_mem *jent_shared_mem_find(uint32_t memsize,
+						    unsigned int flags,
+						    int node)
+{
+	struct jent_shared_mem *shared;
+
+	for (shared = jent_shared_mems; shared; shared = shared->next) {
+		if (shared->memsize == memsize && shared->flags == flags &&
+		    shared->node == node)
+			return shared;
+	}
+
+	return NULL;
+}
+
+/*
+ * Attach @ec to the region of @memsize bytes of its node, allocating the
+ * region if it is the first. Sets ec->mem and its starting offset.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+static int jent_shared_mem_attach(struct rand_data *ec, uint32_t memsize,
+				  unsigned int flags)
+{
+	struct jent_shared_mem *shared, *fresh = NULL;
+	int node = jent_memory_local_node();
+
+	flags &= JENT_SHARED_MEM_FLAGS;
+
+	for (;;) {
+		jent_shared_mem_lock();
+		shared = jent_shared_mem_find(memsize, flags, node);
+		if (!shared && fresh) {
+			fresh->next = jent_shared_mems;
+			jent_shared_mems = fresh;
+			shared = fresh;
+			fresh = NULL;
+		}
+		if (shared) {
+			ec->memlocation = (shared->attached *
+					   JENT_SHARED_MEM_SPREAD) &
+					  (memsize - 1);
+			shared->attached++;
+			shared->users++;
+		}
+		jent_shared_mem_unlock();
+
+		if (shared)
+			break;
+
+		/* Allocated outside the lock; see jent_shared_mems_locked */
+		fresh = jent_zalloc(sizeof(struct jent_shared_mem), 0);
+		if (!fresh)
+			return -1;
+		fresh->mem = jent_zalloc(memsize, flags);
+		if (!fresh->mem) {
+			jent_zfree(fresh, sizeof(struct jent_shared_mem));
+			return -1;
+		}
+		fresh->memsize = memsize;
+		fresh->flags = flags;
+		fresh->node = node;
+	}
+
+	/* Another collector registered the region first */
+	if (fresh) {
+		jent_free_nonsensitive(fresh->mem, memsize);
+		jent_zfree(fresh, sizeof(struct jent_shared_mem));
+	}
+
+	ec->shared_mem = shared;
+	ec->mem = shared->mem;
+
+	return 0;
+}
+
+/* Detach @ec from its region, freeing the region with its last collector */
+static void jent_shared_mem_detach(struct rand_data *ec)
+{
+	struct jent_shared_mem *shared = ec->shared_mem, **prev;
+
+	jent_shared_mem_lock();
+	if (--shared->users) {
+		shared = NULL;
+	} else {
+		for (prev = &jent_shared_mems; *prev != shared;
+		     prev = &(*prev)->next)
+			;
+		*prev = shared->next;
+	}
+	jent_shared_mem_unlock();
+
+	if (shared) {
+		jent_free_nonsensitive(shared->mem, shared->memsize);
+		jent_zfree(shared, sizeof(struct jent_shared_mem));
+	}
+
+	ec->shared_mem = NULL;
+	ec->mem = NULL;
+}
+
+/*
+ * Build a collector, in @buf of @len bytes when @buf is set and in memory of
+ * its own otherwise.
+ */
 static struct rand_data
-*jent_entropy_collector_alloc_internal(unsigned int osr, unsigned int flags)
+*jent_entropy_collector_alloc_internal_at(unsigned int osr, unsigned int flags,
+					  void *buf, size_t len)
 {
 	struct rand_data *entropy_collector;
-	uint32_t memsize = 0;
+	uint32_t memsize = 0, cache;
 
 	/*
 	 * Enforce the invariants of the compile-time tunable OSR bounds: the
@@ -657,6 +1628,10 @@ static struct rand_data
 	if (osr > JENT_MAX_OSR)
 		return NULL;
 
+	/* A fraction would take the highest OSR beyond JENT_MAX_OSR */
+	if (osr == JENT_MAX_OSR)
+		flags &= ~(unsigned int)JENT_OSR_FRACTION_MASK;
+
 	/* Force the self test to be run */
 	if (!jent_atomic_load_int(&jent_selftest_run) &&
 	    jent_entropy_init_ex(osr, flags))
@@ -668,6 +1643,15 @@ static struct rand_data
 	if (flags & JENT_NTG1)
 		flags |= JENT_DISABLE_INTERNAL_TIMER;
 
+	/*
+	 * So does caller memory: starting the timer thread would allocate,
+	 * which is what the caller supplies the memory to avoid.
+	 */
+	if (buf) {
+		flags |= JENT_DISABLE_INTERNAL_TIMER;
+		flags &= ~(unsigned int)JENT_SHARED_MEMORY;
+	}
+
 	/*
 	 * If the initial test code concludes to force the internal timer
 	 * and the user requests it not to be used, do not allocate
@@ -676,10 +1660,30 @@ static struct rand_data
 	if (jent_notime_forced() && (flags & JENT_DISABLE_INTERNAL_TIMER))
 		return NULL;
 
-	entropy_collector = jent_zalloc(sizeof(struct rand_data), flags);
-	if (NULL == entropy_collector)
+	/* Only the memory access patterns and hash kernels that exist */
+	if (JENT_FLAGS_TO_MEMACCESS(flags) >
+	    JENT_FLAGS_TO_MEMACCESS(JENT_MEMACCESS_MAX))
+		return NULL;
+	if (JENT_FLAGS_TO_HASHKERNEL(flags) >
+	    JENT_FLAGS_TO_HASHKERNEL(JENT_HASHKERNEL_MAX))
 		return NULL;
 
+	if (buf) {
+		size_t placed_len = jent_collector_placed_size(flags);
+
+		if (len < placed_len)
+			return NULL;
+
+		jent_memset_secure(buf, placed_len);
+		entropy_collector = buf;
+		entropy_collector->placed_len = placed_len;
+	} else {
+		entropy_collector = jent_zalloc(JENT_COLLECTOR_MEM_OFFSET,
+						flags);
+		if (NULL == entropy_collector)
+			return NULL;
+	}
+
 	/*
 	 * Record whether the caller capped the memory size before
 	 * jent_update_memsize() normalizes the flags. This must happen here
@@ -689,12 +1693,23 @@ static struct rand_data
 	 * caller requested.
 	 */
 	entropy_collector->max_mem_set = !!JENT_FLAGS_TO_MAX_MEMSIZE(flags);
+	entropy_collector->fork_generation = jent_fork_generation();
+	entropy_collector->numa_node = -1;
 
 	if (!(flags & JENT_DISABLE_MEMORY_ACCESS)) {
 		flags = jent_update_memsize(flags, 0);
 		memsize = jent_memsize(flags);
-		entropy_collector->mem =
-			(unsigned char *)jent_zalloc(memsize, flags);
+		if (buf) {
+			entropy_collector->mem =
+				(unsigned char *)buf + JENT_COLLECTOR_MEM_OFFSET;
+		} else if (flags & JENT_SHARED_MEMORY) {
+			if (jent_shared_mem_attach(entropy_collector, memsize,
+						   flags))
+				goto err;
+		} else {
+			entropy_collector->mem =
+				(unsigned char *)jent_zalloc(memsize, flags);
+		}
 
 		if (entropy_collector->mem == NULL)
 			goto err;
@@ -705,14 +1720,35 @@ static struct rand_data
 		 */
 		entropy_collector->memmask = memsize - 1;
 		entropy_collector->memaccessloops = JENT_MEM_ACC_LOOP_DEFAULT;
+
+		/*
+		 * JENT_MEMACCESS_CACHE_STRIDE steps by the size of a cache
+		 * smaller than the block plus an odd remainder: the targeted
+		 * cache, or the L1 cache where the block is only as large as
+		 * the targeted one, as it is with JENT_CACHE_ALL. Without such
+		 * a cache the remainder alone is left.
+		 */
+		cache = jent_cache_size_roundup(!!(flags & JENT_CACHE_ALL));
+		if (cache >= memsize)
+			cache = jent_cache_size_roundup(0);
+		if (cache >= memsize)
+			cache = 0;
+		entropy_collector->memstride =
+			(cache + JENT_MEMORY_BLOCKSIZE - 1) & (memsize - 1);
 	}
 
 	/* Set the hash loop count */
 	flags = jent_update_hashloop(flags, 0);
 	entropy_collector->hashloopcnt = jent_hashloop_cnt(flags);
 
-	if (jent_sha3_alloc(&entropy_collector->hash_state, flags))
-		goto err;
+	/* The ceiling of the latency controller */
+	entropy_collector->latency_mem_loops_max =
+		entropy_collector->memaccessloops;
+	entropy_collector->latency_hash_loops_max =
+		entropy_collector->hashloopcnt;
+
+	entropy_collector->hash_state =
+		(unsigned char *)entropy_collector + JENT_COLLECTOR_HASH_OFFSET;
 
 	/*
 	 * Initialize the hash state for the XDRBG
@@ -733,6 +1769,11 @@ static struct rand_data
 	entropy_collector->osr = osr;
 	entropy_collector->flags = flags;
 
+	/* The floor of JENT_ADAPTIVE_OSR, see jent_collector_carry_over() */
+	entropy_collector->osr_floor = osr;
+	entropy_collector->flags_floor = flags;
+	entropy_collector->adaptive_window = JENT_ADAPTIVE_OSR_WINDOW;
+
 	/*
 	 * BSI AIS 20/31 NTG.1 requires that during startup 2 noise sources
 	 * are sampled where each independently delivers 240 bits of entropy.
@@ -748,6 +1789,15 @@ static struct rand_data
 		entropy_collector->is_fips_enabled = 1;
 	}
 
+	/*
+	 * The scheduling noise source of JENT_SCHED_NOISE is a third source
+	 * that has to deliver its share of the startup entropy alone as well,
+	 * in a stage ahead of the other two.
+	 */
+	if ((flags & JENT_SCHED_NOISE) &&
+	    entropy_collector->startup_state == jent_startup_memory)
+		entropy_collector->startup_state = jent_startup_sched;
+
 	/* Initialize the health tests */
 	jent_health_init(entropy_collector, flags & JENT_NTG1 ?
 					    jent_health_init_type_ntg1 :
@@ -779,8 +1829,15 @@ err:
 	return NULL;
 }
 
-static struct rand_data *_jent_entropy_collector_alloc(unsigned int osr,
-						       unsigned int flags)
+static struct rand_data
+*jent_entropy_collector_alloc_internal(unsigned int osr, unsigned int flags)
+{
+	return jent_entropy_collector_alloc_internal_at(osr, flags, NULL, 0);
+}
+
+static struct rand_data *jent_entropy_collector_prepare(unsigned int osr,
+							unsigned int flags,
+							void *buf, size_t len)
 {
 	struct rand_data *ec;
 
@@ -805,81 +1862,112 @@ static struct rand_data *_jent_entropy_collector_alloc(unsigned int osr,
 
 	flags = jent_update_secure_mem(flags);
 
-	ec = jent_entropy_collector_alloc_internal(osr, flags);
+	ec = jent_entropy_collector_alloc_internal_at(osr, flags, buf, len);
+	if (ec)
+		ec->starting = 1;
 
-	if (!ec)
-		return ec;
+	return ec;
+}
 
-	/* fill the data pad with non-zero values */
-	if (jent_notime_settick(ec)) {
-		jent_entropy_collector_free(ec);
-		return NULL;
-	}
+/*
+ * Run one round of the startup of *ec: fill the data pad with one block.
+ *
+ * Assure, that we always have 512 bits (NTG.1 / FIPS compliance due to
+ * startup_state is set to 2) or 256 bits (other cases) entropy in
+ * our hash state before outputting a block by adding at least 256 bits
+ * before first usage. 512 bits are always transferred to the next state
+ * before the actual generation of random numbers to be returned to the
+ * caller. The size is due to the XDRBG state variable.
+ *
+ * For NTG.1: the rounds perform the startup stages guaranteeing the
+ * invocation of 2 noise sources each delivering 240 bits of entropy
+ * at least before the first output.
+ *
+ * @return 0 once the startup completed, JENT_ERR_STARTING while it needs
+ *	   another round, or the error that stops it; *ec is then left to the
+ *	   caller
+ */
+static int jent_startup_round(struct rand_data **ec)
+{
+	unsigned int health_test_result;
+
+	if (jent_notime_settick(*ec))
+		return JENT_ERR_NOTIME;
+
+	jent_random_data(*ec);
 
 	/*
-	 * Assure, that we always have 512 bits (NTG.1 / FIPS compliance due to
-	 * startup_state is set to 2) or 256 bits (other cases) entropy in
-	 * our hash state before outputting a block by adding at least 256 bits
-	 * before first usage. 512 bits are always transferred to the next state
-	 * before the actual generation of random numbers to be returned to the
-	 * caller. The size is due to the XDRBG state variable.
-	 *
-	 * For NTG.1: already perform the startup stages guaranteeing the
-	 * invocation of 2 noise sources each delivering 240 bits of entropy
-	 * at least at this point.
+	 * Check for any kind of health error at this point including
+	 * intermittent or permanent errors. If we observed one,
+	 * re-initialize the entropy collector.
 	 */
-	do {
-		jent_random_data(ec);
+	if ((health_test_result = jent_health_failure(*ec))) {
 
 		/*
-		 * Check for any kind of health error at this point including
-		 * intermittent or permanent errors. If we observed one,
-		 * re-initialize the entropy collector.
+		 * Re-allocate the entropy collector with updated
+		 * OSR, hash loop count and memory size.
 		 */
-		if (jent_health_failure(ec)) {
+		if (jent_health_failure_reset(
+			ec, jent_entropy_collector_alloc_internal)) {
+			jent_notime_unsettick(*ec);
+			return jent_health_error(health_test_result);
+		}
 
-			/*
-			 * Re-allocate the entropy collector with updated
-			 * OSR, hash loop count and memory size.
-			 */
-			if (jent_health_failure_reset(
-				&ec, jent_entropy_collector_alloc_internal)) {
-				jent_entropy_collector_free(ec);
-				return NULL;
-			}
+		/*
+		 * The reset freed the old collector together with its timer
+		 * thread. The next round starts the one of the replacement
+		 * and reruns the startup sequence on it.
+		 */
+		(*ec)->starting = 1;
+		return JENT_ERR_STARTING;
+	}
 
-			/*
-			 * The reset replaced ec with a freshly allocated
-			 * collector. That new collector has enable_notime
-			 * set but no running timer thread (the old thread
-			 * was stopped when the old collector was freed).
-			 * Restart the timer thread before re-entering the
-			 * loop, otherwise jent_get_nstime_internal will
-			 * spin forever waiting for a counter that nobody
-			 * increments.
-			 */
-			if (jent_notime_settick(ec)) {
-				jent_entropy_collector_free(ec);
-				return NULL;
-			}
+	jent_notime_unsettick(*ec);
 
-			/* Rerun startup sequence */
-			continue;
-		}
-	} while (ec->startup_state != jent_startup_completed);
+	if ((*ec)->startup_state != jent_startup_completed)
+		return JENT_ERR_STARTING;
 
-	jent_notime_unsettick(ec);
+	(*ec)->starting = 0;
 
 	/*
 	 * Assign the stable per-instance identifier. This is done once, after a
 	 * successful startup; jent_health_failure_reset() carries it over to the
 	 * replacement collector so the identity survives a reallocation.
 	 */
-	jent_uuid_generate(ec->uuid);
+	jent_uuid_generate((*ec)->uuid);
+
+	return 0;
+}
+
+static struct rand_data *_jent_entropy_collector_alloc_at(unsigned int osr,
+							  unsigned int flags,
+							  void *buf, size_t len)
+{
+	struct rand_data *ec;
+	int ret;
+
+	ec = jent_entropy_collector_prepare(osr, flags, buf, len);
+	if (!ec)
+		return ec;
+
+	do {
+		ret = jent_startup_round(&ec);
+	} while (ret == JENT_ERR_STARTING);
+
+	if (ret) {
+		jent_entropy_collector_free(ec);
+		return NULL;
+	}
 
 	return ec;
 }
 
+static struct rand_data *_jent_entropy_collector_alloc(unsigned int osr,
+						       unsigned int flags)
+{
+	return _jent_entropy_collector_alloc_at(osr, flags, NULL, 0);
+}
+
 JENT_PRIVATE_STATIC
 struct rand_data *jent_entropy_collector_alloc(unsigned int osr,
 					       unsigned int flags)
@@ -891,6 +1979,54 @@ struct rand_data *jent_entropy_collector_alloc(unsigned int osr,
 	return _jent_entropy_collector_alloc(osr, flags);
 }
 
+JENT_PRIVATE_STATIC
+struct rand_data *jent_entropy_collector_alloc_deferred(unsigned int osr,
+							unsigned int flags)
+{
+	return jent_entropy_collector_prepare(osr, flags, NULL, 0);
+}
+
+JENT_PRIVATE_STATIC
+int jent_entropy_collector_start(struct rand_data **ec)
+{
+	if (!ec || !*ec)
+		return JENT_ERR_EINVAL;
+
+	if (!(*ec)->starting)
+		return 0;
+
+	return jent_startup_round(ec);
+}
+
+JENT_PRIVATE_STATIC
+size_t jent_entropy_collector_size(unsigned int osr, unsigned int flags)
+{
+	if (ensure_osr_is_at_least_minimal(osr) > JENT_MAX_OSR)
+		return 0;
+
+	return jent_collector_placed_size(jent_update_secure_mem(flags));
+}
+
+JENT_PRIVATE_STATIC
+struct rand_data *jent_entropy_collector_init(void *buf, size_t len,
+					      unsigned int osr,
+					      unsigned int flags)
+{
+	if (!buf || ((uintptr_t)buf & (JENT_COLLECTOR_ALIGN - 1)))
+		return NULL;
+
+	/*
+	 * The library cannot lock caller memory, so it cannot grant a request
+	 * for secure memory either. The flag implied by JENT_NTG1 and
+	 * JENT_FORCE_FIPS is not refused: locking buf is the caller's business
+	 * then, see jitterentropy.h.
+	 */
+	if (flags & JENT_FORCE_SECURE_MEM)
+		return NULL;
+
+	return _jent_entropy_collector_alloc_at(osr, flags, buf, len);
+}
+
 #ifdef LINUX_KERNEL
 /*
  * Test interface support: allocate an entropy collector without running the
@@ -920,11 +2056,16 @@ void jent_entropy_collector_free(struct rand_data *entropy_collector)
 
 		jent_notime_disable(entropy_collector);
 
-		if (entropy_collector->hash_state != NULL) {
-			jent_sha3_dealloc(entropy_collector->hash_state);
-			entropy_collector->hash_state = NULL;
+		/* Caller memory is the caller's to release */
+		if (entropy_collector->placed_len) {
+			jent_memset_secure(entropy_collector,
+					   entropy_collector->placed_len);
+			return;
 		}
 
+		if (entropy_collector->shared_mem)
+			jent_shared_mem_detach(entropy_collector);
+
 		if (entropy_collector->mem != NULL) {
 			/*
 			 * Use memmask (== memsize - 1, set whenever mem was
@@ -933,12 +2074,18 @@ void jent_entropy_collector_free(struct rand_data *entropy_collector)
 			 * may not have been assigned yet, in which case
 			 * jent_memsize(->flags) would return the default size and
 			 * mis-size the free (heap overflow or partial zeroization).
+			 *
+			 * The region holds no secret and is not wiped: the
+			 * memset dominated the time a large collector took to
+			 * free, also in the reallocation of a health failure
+			 * recovery. The state and hash state still are.
 			 */
-			jent_zfree(entropy_collector->mem,
-				   (size_t)entropy_collector->memmask + 1);
+			jent_free_nonsensitive(entropy_collector->mem,
+				(size_t)entropy_collector->memmask + 1);
 			entropy_collector->mem = NULL;
 		}
-		jent_zfree(entropy_collector, sizeof(struct rand_data));
+		/* Wipes the hash state behind the structure as well */
+		jent_zfree(entropy_collector, JENT_COLLECTOR_MEM_OFFSET);
 	}
 }
 
@@ -1152,7 +2299,8 @@ int jent_selftest(struct rand_data *ec)
  * JENT_FORCE_SECURE_MEM must reach it as well, or the initialization would
  * report success on memory the collector allocation is then going to reject.
  */
-static inline int jent_entropy_init_common_pre(unsigned int flags)
+static inline int jent_entropy_init_common_pre(unsigned int flags,
+					       int record)
 {
 	int ret;
 
@@ -1165,15 +2313,16 @@ static inline int jent_entropy_init_common_pre(unsigned int flags)
 
 	ret = jent_gcd_selftest(flags);
 
-	jent_atomic_store_int(&jent_selftest_run, 1);
+	if (record)
+		jent_atomic_store_int(&jent_selftest_run, 1);
 
 	return ret;
 }
 
-static inline int jent_entropy_init_common_post(int ret)
+static inline int jent_entropy_init_common_post(int ret, int record)
 {
 	/* Unmark the execution of the self tests if they failed. */
-	if (ret)
+	if (ret && record)
 		jent_atomic_store_int(&jent_selftest_run, 0);
 
 	return ret;
@@ -1199,7 +2348,7 @@ static inline int jent_entropy_init_common_post(int ret)
 JENT_PRIVATE_STATIC
 int jent_entropy_init(void)
 {
-	int ret = jent_entropy_init_common_pre(0);
+	int ret = jent_entropy_init_common_pre(0, 1);
 
 	if (ret)
 		return ret;
@@ -1211,11 +2360,17 @@ int jent_entropy_init(void)
 		ret = jent_time_entropy_init(0, JENT_FORCE_INTERNAL_TIMER);
 #endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
 
-	return jent_entropy_init_common_post(ret);
+	return jent_entropy_init_common_post(ret, 1);
 }
 
-JENT_PRIVATE_STATIC
-int jent_entropy_init_ex(unsigned int osr, unsigned int flags)
+/*
+ * jent_entropy_init_ex(), with record cleared for the rungs of
+ * jent_osr_ladder_search(): their verdicts are about one configuration each,
+ * and as they run at once, a failing one must not unmark the self tests a
+ * passing one or an earlier initialization recorded for the process.
+ */
+static int jent_entropy_init_internal(unsigned int osr, unsigned int flags,
+				      int record)
 {
 	int ret;
 
@@ -1227,7 +2382,7 @@ int jent_entropy_init_ex(unsigned int osr, unsigned int flags)
 	 */
 	flags = jent_update_secure_mem(flags);
 
-	ret = jent_entropy_init_common_pre(flags);
+	ret = jent_entropy_init_common_pre(flags, record);
 
 	if (ret)
 		return ret;
@@ -1239,7 +2394,7 @@ int jent_entropy_init_ex(unsigned int osr, unsigned int flags)
 	 * answered with EMEM after the allocation had already refused it.
 	 */
 	if ((flags & JENT_NTG1) && (flags & JENT_FORCE_INTERNAL_TIMER))
-		return jent_entropy_init_common_post(ENOTIME);
+		return jent_entropy_init_common_post(ENOTIME, record);
 
 	ret = ENOTIME;
 
@@ -1269,7 +2424,13 @@ int jent_entropy_init_ex(unsigned int osr, unsigned int flags)
 					     flags | JENT_FORCE_INTERNAL_TIMER);
 #endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
 
-	return jent_entropy_init_common_post(ret);
+	return jent_entropy_init_common_post(ret, record);
+}
+
+JENT_PRIVATE_STATIC
+int jent_entropy_init_ex(unsigned int osr, unsigned int flags)
+{
+	return jent_entropy_init_internal(osr, flags, 1);
 }
 
 JENT_PRIVATE_STATIC
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "jitterentropy.h"
+#include "jitterentropy-internal.h"
+#include "jitterentropy-sha3.h"
+
+/***************************************************************************
+ * XDRBG children
+ *
+ * A child is an XDRBG-256 of its own - the construction the collector
+ * conditions its blocks with, see jent_xdrbg256_generate_block() - whose seed
+ * comes from the output of a collector rather than from jitter of its own.
+ * Generating from it costs two Keccak permutations per 32 bytes and no
+ * measurement, and since it is owned by one thread it takes no lock.
+ *
+ * Only the reseed goes back to the collector. A child holds the pointer of the
+ * caller to it rather than the collector itself, and reseeds through
+ * jent_read_entropy_safe(): a health failure recovery or a step down of the
+ * adaptive oversampling rate replaces the collector, updates that pointer and
+ * leaves the children with the replacement instead of a freed collector. The
+ * children may reseed on as many threads at once, so the reseeds are
+ * serialized with a lock of this file - not one in the collector, which may be
+ * freed while another reseed waits for it. Reseeds are rare enough for the
+ * children of all collectors to share it. A caller reading from the collector
+ * directly while children of it are in use on other threads must hold off the
+ * same way it would for any two readers of a collector.
+ *
+ * A child reseeds when it has generated its reseed threshold since the last
+ * seed and in the first call after a fork() copied it, which would otherwise
+ * generate the same output in parent and child.
+ ***************************************************************************/
+
+/* Seed drawn from the collector: two of its blocks */
+#define JENT_DRBG_CHILD_SEED	(2 * (DATA_SIZE_BITS / 8))
+
+/* Output between two reseeds unless the caller sets it */
+#define JENT_DRBG_CHILD_RESEED_DEFAULT	(1UL << 20)
+
+/* Serializes the reseeds of all children */
+static int jent_drbg_child_lock = 0;
+
+struct jent_drbg_child {
+	struct jent_sha_ctx *state;	/* XDRBG-256 state */
+	struct rand_data **parent;	/* Collector the seeds come from */
+	uint64_t reseed_bytes;		/* Output between two reseeds */
+	uint64_t output;		/* Output since the last reseed */
+	uint32_t fork_generation;	/* See jent_fork_generation() */
+	unsigned int seeded:1;		/* A reseed has not failed since */
+};
+
+static int jent_drbg_child_reseed(struct jent_drbg_child *child)
+{
+	uint8_t seed[JENT_DRBG_CHILD_SEED];
+	ssize_t ret;
+
+	child->seeded = 0;
+
+	while (jent_atomic_exchange_int(&jent_drbg_child_lock, 1))
+		;
+	ret = jent_read_entropy_safe(child->parent, (char *)seed,
+				     sizeof(seed));
+	jent_atomic_store_int(&jent_drbg_child_lock, 0);
+
+	if (ret < 0) {
+		jent_memset_secure(seed, sizeof(seed));
+		return (int)ret;
+	}
+
+	/* The generate of the next block completes the (re)seed */
+	jent_sha3_update(child->state, seed, sizeof(seed));
+	jent_memset_secure(seed, sizeof(seed));
+
+	child->fork_generation = jent_fork_generation();
+	child->output = 0;
+	child->seeded = 1;
+
+	return 0;
+}
+
+JENT_PRIVATE_STATIC
+struct jent_drbg_child *jent_drbg_child_alloc(struct rand_data **ec,
+					      uint64_t reseed_bytes)
+{
+	struct jent_drbg_child *child;
+
+	if (!ec || !*ec)
+		return NULL;
+
+	child = jent_zalloc(sizeof(struct jent_drbg_child), 0);
+	if (!child)
+		return NULL;
+
+	/* The state is key material: it gets the memory of the collector */
+	if (jent_sha3_alloc((void **)&child->state, (*ec)->flags)) {
+		jent_zfree(child, sizeof(struct jent_drbg_child));
+		return NULL;
+	}
+	jent_shake256_init(child->state);
+
+	child->parent = ec;
+	child->reseed_bytes = reseed_bytes ? reseed_bytes :
+					     JENT_DRBG_CHILD_RESEED_DEFAULT;
+
+	if (jent_drbg_child_reseed(child)) {
+		jent_drbg_child_free(child);
+		return NULL;
+	}
+
+	return child;
+}
+
+JENT_PRIVATE_STATIC
+ssize_t jent_drbg_child_generate(struct jent_drbg_child *child, char *data,
+				 size_t len)
+{
+	static const size_t ssize_max = (size_t)-1 >> 1;
+	size_t done = 0, tocopy;
+	int ret;
+
+	if (!child || (data == NULL && len > 0))
+		return JENT_ERR_EINVAL;
+
+	/* Clamp to ssize_t range, as jent_read_entropy() does */
+	if (len > ssize_max)
+		len = ssize_max;
+
+	if (child->fork_generation != jent_fork_generation())
+		child->seeded = 0;
+
+	while (done < len) {
+		if (!child->seeded || child->output >= child->reseed_bytes) {
+			ret = jent_drbg_child_reseed(child);
+			if (ret)
+				return ret;
+		}
+
+		tocopy = len - done;
+		if (tocopy > (DATA_SIZE_BITS / 8))
+			tocopy = (DATA_SIZE_BITS / 8);
+
+		jent_drbg_generate_block(child->state, (uint8_t *)data + done,
+					 tocopy);
+		child->output += tocopy;
+		done += tocopy;
+	}
+
+	return (ssize_t)done;
+}
+
+JENT_PRIVATE_STATIC
+void jent_drbg_child_free(struct jent_drbg_child *child)
+{
+	if (!child)
+		return;
+
+	jent_sha3_dealloc(child->state);
+	jent_zfree(child, sizeof(struct jent_drbg_child));
+}
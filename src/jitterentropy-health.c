@@ -57,6 +57,37 @@ int jent_set_fips_failure_callback_internal(jent_fips_failure_cb cb)
 	return 0;
 }
 
+/*
+ * The cutoff of the lag predictor or the APT for the oversampling rate of
+ * @ec, out of @table of @entries cutoffs indexed by the rate - 1; rates
+ * beyond the table take its last entry.
+ *
+ * These cutoffs are quantiles of the binomial distribution at alpha down to
+ * 2^-60, which cannot be computed without floating point and so only exist
+ * as the tables of tests/health/cutoffs.py for integer rates. A fraction added
+ * by the JENT_OSR_PLUS_* flags is interpolated linearly between the entries
+ * of the integer rates below and above, in quarters and rounded up. The entry
+ * above alone would assume the entropy of the higher rate and let the test
+ * miss what the fractional rate is there to catch.
+ */
+static unsigned int jent_health_cutoff(const struct rand_data *ec,
+				       const unsigned int *table,
+				       unsigned int entries)
+{
+	unsigned int quarters = JENT_FLAGS_TO_OSR_FRACTION(ec->flags);
+	unsigned int low, high;
+
+	if (ec->osr >= entries)
+		return table[entries - 1];
+
+	low = table[ec->osr - 1];
+	high = table[ec->osr];
+	if (high < low)
+		return low - ((low - high) * quarters) / 4;
+
+	return low + ((high - low) * quarters + 3) / 4;
+}
+
 /***************************************************************************
  * Lag Predictor Test
  *
@@ -113,7 +144,7 @@ static const unsigned int jent_lag_local_cutoff_permanent_lookup[20] =
 	{  60, 119, 177, 234, 291,  347,  404,  460,  516,  571,
 	  627, 683, 738, 793, 848,  903,  958, 1013, 1068, 1123 };
 
-static void jent_lag_init(struct rand_data *ec, unsigned int osr)
+static void jent_lag_init(struct rand_data *ec)
 {
 	/* Every oversampling rate the library accepts needs an entry. */
 	JENT_BUILD_BUG_ON(JENT_ARRAY_SIZE(jent_lag_global_cutoff_lookup) <
@@ -129,31 +160,18 @@ static void jent_lag_init(struct rand_data *ec, unsigned int osr)
 	 * Establish the lag global and local cutoffs based on the presumed
 	 * entropy rate of 1/osr.
 	 */
-	if (osr > JENT_ARRAY_SIZE(jent_lag_global_cutoff_lookup)) {
-		ec->lag_global_cutoff =
-			jent_lag_global_cutoff_lookup[
-				JENT_ARRAY_SIZE(jent_lag_global_cutoff_lookup) - 1];
-		ec->lag_global_cutoff_permanent =
-			jent_lag_global_cutoff_permanent_lookup[
-				JENT_ARRAY_SIZE(jent_lag_global_cutoff_permanent_lookup) - 1];
-	} else {
-		ec->lag_global_cutoff = jent_lag_global_cutoff_lookup[osr - 1];
-		ec->lag_global_cutoff_permanent =
-			jent_lag_global_cutoff_permanent_lookup[osr - 1];
-	}
-
-	if (osr > JENT_ARRAY_SIZE(jent_lag_local_cutoff_lookup)) {
-		ec->lag_local_cutoff =
-			jent_lag_local_cutoff_lookup[
-				JENT_ARRAY_SIZE(jent_lag_local_cutoff_lookup) - 1];
-		ec->lag_local_cutoff_permanent =
-			jent_lag_local_cutoff_permanent_lookup[
-				JENT_ARRAY_SIZE(jent_lag_local_cutoff_permanent_lookup) - 1];
-	} else {
-		ec->lag_local_cutoff = jent_lag_local_cutoff_lookup[osr - 1];
-		ec->lag_local_cutoff_permanent =
-			jent_lag_local_cutoff_permanent_lookup[osr - 1];
-	}
+	ec->lag_global_cutoff = jent_health_cutoff(ec,
+		jent_lag_global_cutoff_lookup,
+		JENT_ARRAY_SIZE(jent_lag_global_cutoff_lookup));
+	ec->lag_global_cutoff_permanent = jent_health_cutoff(ec,
+		jent_lag_global_cutoff_permanent_lookup,
+		JENT_ARRAY_SIZE(jent_lag_global_cutoff_permanent_lookup));
+	ec->lag_local_cutoff = jent_health_cutoff(ec,
+		jent_lag_local_cutoff_lookup,
+		JENT_ARRAY_SIZE(jent_lag_local_cutoff_lookup));
+	ec->lag_local_cutoff_permanent = jent_health_cutoff(ec,
+		jent_lag_local_cutoff_permanent_lookup,
+		JENT_ARRAY_SIZE(jent_lag_local_cutoff_permanent_lookup));
 }
 
 /**
@@ -323,10 +341,9 @@ static inline uint64_t jent_delta3(struct rand_data *ec, uint64_t delta2)
 	return delta3;
 }
 
-static inline void jent_lag_init(struct rand_data *ec, unsigned int osr)
+static inline void jent_lag_init(struct rand_data *ec)
 {
 	(void)ec;
-	(void)osr;
 }
 
 void jent_lag_duplicate(struct rand_data *new_ec, struct rand_data *old_ec)
@@ -380,16 +397,11 @@ static void jent_apt_init(struct rand_data *ec)
 	 * Establish the apt_cutoff based on the presumed entropy rate of
 	 * 1/osr.
 	 */
-	if (ec->osr >= JENT_ARRAY_SIZE(jent_apt_cutoff_lookup)) {
-		ec->apt_cutoff = jent_apt_cutoff_lookup[
-			JENT_ARRAY_SIZE(jent_apt_cutoff_lookup) - 1];
-		ec->apt_cutoff_permanent = jent_apt_cutoff_permanent_lookup[
-			JENT_ARRAY_SIZE(jent_apt_cutoff_permanent_lookup) - 1];
-	} else {
-		ec->apt_cutoff = jent_apt_cutoff_lookup[ec->osr - 1];
-		ec->apt_cutoff_permanent =
-				jent_apt_cutoff_permanent_lookup[ec->osr - 1];
-	}
+	ec->apt_cutoff = jent_health_cutoff(ec, jent_apt_cutoff_lookup,
+		JENT_ARRAY_SIZE(jent_apt_cutoff_lookup));
+	ec->apt_cutoff_permanent = jent_health_cutoff(ec,
+		jent_apt_cutoff_permanent_lookup,
+		JENT_ARRAY_SIZE(jent_apt_cutoff_permanent_lookup));
 }
 
 /*
@@ -415,17 +427,11 @@ static void jent_apt_init_ntg1(struct rand_data *ec)
 	JENT_BUILD_BUG_ON(JENT_ARRAY_SIZE(jent_apt_cutoff_permanent_lookup_ntg1) <
 			  JENT_MAX_OSR);
 
-	if (ec->osr >= JENT_ARRAY_SIZE(jent_apt_cutoff_lookup_ntg1)) {
-		ec->apt_cutoff = jent_apt_cutoff_lookup_ntg1[
-			JENT_ARRAY_SIZE(jent_apt_cutoff_lookup_ntg1) - 1];
-		ec->apt_cutoff_permanent =
-			jent_apt_cutoff_permanent_lookup_ntg1[
-			JENT_ARRAY_SIZE(jent_apt_cutoff_permanent_lookup_ntg1) - 1];
-	} else {
-		ec->apt_cutoff = jent_apt_cutoff_lookup_ntg1[ec->osr - 1];
-		ec->apt_cutoff_permanent =
-			jent_apt_cutoff_permanent_lookup_ntg1[ec->osr - 1];
-	}
+	ec->apt_cutoff = jent_health_cutoff(ec, jent_apt_cutoff_lookup_ntg1,
+		JENT_ARRAY_SIZE(jent_apt_cutoff_lookup_ntg1));
+	ec->apt_cutoff_permanent = jent_health_cutoff(ec,
+		jent_apt_cutoff_permanent_lookup_ntg1,
+		JENT_ARRAY_SIZE(jent_apt_cutoff_permanent_lookup_ntg1));
 }
 
 static void jent_apt_reinit(struct rand_data *ec,
@@ -551,6 +557,102 @@ static const unsigned short jent_rct_mem_cutoff_permanent_lookup[] =
 	{ 108,  215,  322,  429,  536,  643,  750,  857,  964, 1071,
 	  1178, 1285, 1392, 1499, 1606, 1713, 1820, 1927, 2034, 2141 };
 
+/*
+ * Integer square root, rounded down.
+ */
+static uint64_t jent_isqrt64(uint64_t x)
+{
+	uint64_t res = 0, bit = (uint64_t)1 << 62;
+
+	while (bit > x)
+		bit >>= 2;
+
+	while (bit) {
+		if (x >= res + bit) {
+			x -= res + bit;
+			res = (res >> 1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return res;
+}
+
+#define JENT_Q30	((uint64_t)1 << 30)
+
+/*
+ * 2^(num/den) for num <= den in fixed point with 30 fraction bits: one factor
+ * 2^(2^-i) for every bit i of the binary fraction num/den, each factor the
+ * square root of the one before.
+ */
+static uint64_t jent_exp2_frac_q30(unsigned int num, unsigned int den)
+{
+	uint64_t res = JENT_Q30, root = 2 * JENT_Q30;
+	unsigned int i;
+
+	if (num >= den)
+		return 2 * JENT_Q30;
+
+	for (i = 0; i < 30; i++) {
+		root = jent_isqrt64(root << 30);
+		num <<= 1;
+		if (num >= den) {
+			num -= den;
+			res = (res * root) >> 30;
+		}
+	}
+
+	return res;
+}
+
+/*
+ * The RCT with memory cutoff for an oversampling rate given in quarters,
+ * computed at run time from the formula above - the one
+ * tests/health/cutoffs.py implements - in fixed point, as the kernel build
+ * has no floating point. The fractional rates of the JENT_OSR_PLUS_* flags use
+ * it instead of the tables, which only cover integer rates; at those it
+ * yields the table entries, which the unit tests verify.
+ *
+ * @param[in] osr_quarters Oversampling rate in quarters
+ * @param[in] safety_factor Safety factor of the entropy assumption
+ * @param[in] tau Standard deviations above the mean
+ * @param[in] cap_offset Offset of the cap above n
+ *
+ * @return cutoff
+ */
+static unsigned short jent_rct_mem_cutoff(unsigned int osr_quarters,
+					  unsigned int safety_factor,
+					  unsigned int tau,
+					  unsigned int cap_offset)
+{
+	/* n = 107 * osr, held in quarters like the rate */
+	uint64_t n_quarters = (uint64_t)107 * osr_quarters;
+	uint64_t p, var_p, sd, cutoff, cap;
+	unsigned int exp_den = 4 * safety_factor, shift = 0;
+
+	/*
+	 * p = 2^(1 - safety_factor/osr) = 2^-shift * 2^(num/osr_quarters)
+	 * with the integer shift bringing num/osr_quarters into [0, 1].
+	 */
+	while (exp_den > osr_quarters * (shift + 1))
+		shift++;
+	p = jent_exp2_frac_q30(osr_quarters * (shift + 1) - exp_den,
+			       osr_quarters) >> shift;
+
+	var_p = p < JENT_Q30 / 2 ? p : JENT_Q30 / 2;
+	var_p = (var_p * (JENT_Q30 - var_p)) >> 30;
+
+	/* sqrt(n * p' * (1 - p')), 15 fraction bits */
+	sd = jent_isqrt64((n_quarters * var_p) >> 2);
+
+	cutoff = (((n_quarters * p) >> 2) + ((tau * sd) << 15)) >> 30;
+	cap = (n_quarters >> 2) + cap_offset;
+
+	return (unsigned short)(cutoff < cap ? cutoff : cap);
+}
+
 static void jent_rct_mem_init(struct rand_data *ec)
 {
 	/* Every oversampling rate the library accepts needs an entry. */
@@ -559,7 +661,12 @@ static void jent_rct_mem_init(struct rand_data *ec)
 	JENT_BUILD_BUG_ON(JENT_ARRAY_SIZE(jent_rct_mem_cutoff_permanent_lookup) <
 			  JENT_MAX_OSR);
 
-	if (ec->osr >= JENT_ARRAY_SIZE(jent_rct_mem_cutoff_lookup)) {
+	if (JENT_FLAGS_TO_OSR_FRACTION(ec->flags)) {
+		ec->rct_mem_cutoff =
+			jent_rct_mem_cutoff(JENT_OSR_QUARTERS(ec), 1, 4, 0);
+		ec->rct_mem_cutoff_permanent =
+			jent_rct_mem_cutoff(JENT_OSR_QUARTERS(ec), 1, 5, 1);
+	} else if (ec->osr >= JENT_ARRAY_SIZE(jent_rct_mem_cutoff_lookup)) {
 		ec->rct_mem_cutoff = jent_rct_mem_cutoff_lookup[
 			JENT_ARRAY_SIZE(jent_rct_mem_cutoff_lookup) - 1];
 		ec->rct_mem_cutoff_permanent =
@@ -595,7 +702,12 @@ static void jent_rct_mem_init_ntg1(struct rand_data *ec)
 	JENT_BUILD_BUG_ON(JENT_ARRAY_SIZE(jent_rct_mem_cutoff_permanent_lookup_ntg1) <
 			  JENT_MAX_OSR);
 
-	if (ec->osr >= JENT_ARRAY_SIZE(jent_rct_mem_cutoff_lookup_ntg1)) {
+	if (JENT_FLAGS_TO_OSR_FRACTION(ec->flags)) {
+		ec->rct_mem_cutoff =
+			jent_rct_mem_cutoff(JENT_OSR_QUARTERS(ec), 8, 4, 0);
+		ec->rct_mem_cutoff_permanent =
+			jent_rct_mem_cutoff(JENT_OSR_QUARTERS(ec), 8, 5, 1);
+	} else if (ec->osr >= JENT_ARRAY_SIZE(jent_rct_mem_cutoff_lookup_ntg1)) {
 		ec->rct_mem_cutoff = jent_rct_mem_cutoff_lookup_ntg1[
 			JENT_ARRAY_SIZE(jent_rct_mem_cutoff_lookup_ntg1) - 1];
 		ec->rct_mem_cutoff_permanent =
@@ -664,6 +776,9 @@ static void jent_rct_mem_insert(struct rand_data *ec, unsigned int stuck)
 		 */
 		if (!ec->in_recovery) {
 			enum jent_startup_state saved_state = ec->startup_state;
+			unsigned short saved_samples = ec->block_samples;
+			unsigned int saved_step = ec->step_samples;
+			uint64_t saved_deadline = ec->read_deadline;
 			unsigned int i;
 
 			/*
@@ -687,8 +802,21 @@ static void jent_rct_mem_insert(struct rand_data *ec, unsigned int stuck)
 			 * terminate.
 			 */
 			ec->startup_state = jent_startup_completed;
+
+			/*
+			 * Likewise the sample count of the outer block: the
+			 * recursive blocks are complete blocks of their own,
+			 * which neither a deadline of jent_read_entropy_timed()
+			 * nor the samples of jent_entropy_step() cut short.
+			 */
+			ec->block_samples = 0;
+			ec->step_samples = 0;
+			ec->read_deadline = 0;
 			for (i = 0; i < JENT_RCT_MEM_RECOVERY_LOOP_CNT; i++)
 				jent_random_data(ec);
+			ec->block_samples = saved_samples;
+			ec->step_samples = saved_step;
+			ec->read_deadline = saved_deadline;
 			ec->startup_state = saved_state;
 			ec->in_recovery = 0;
 
@@ -747,10 +875,13 @@ void jent_rct_mem_duplicate(struct rand_data *new_ec, struct rand_data *old_ec)
  ***************************************************************************/
 static void jent_rct_init(struct rand_data *ec, unsigned short safety)
 {
-	unsigned short osr = (unsigned short)ec->osr;
+	unsigned int osr_quarters = JENT_OSR_QUARTERS(ec);
 
-	ec->rct_cutoff = JENT_HEALTH_RCT_INTERMITTENT_CUTOFF(osr);
-	ec->rct_cutoff_permanent = JENT_HEALTH_RCT_PERMANENT_CUTOFF(osr);
+	/* The cutoff of a fractional rate, rounded up like the margin below */
+	ec->rct_cutoff = (unsigned short)
+		((JENT_HEALTH_RCT_INTERMITTENT_CUTOFF(osr_quarters) + 3) >> 2);
+	ec->rct_cutoff_permanent = (unsigned short)
+		((JENT_HEALTH_RCT_PERMANENT_CUTOFF(osr_quarters) + 3) >> 2);
 
 	if (safety) {
 		ec->rct_cutoff = (unsigned short)
@@ -834,6 +965,100 @@ unsigned int jent_stuck(struct rand_data *ec, uint64_t current_delta)
 	return stuck;
 }
 
+/*
+ * The cutoffs of the RCT and APT of the scheduling noise source. The round
+ * trip is only credited as part of the sample of the common operation, whose
+ * entropy rate is 1/osr, so they are those of that rate whatever the startup
+ * type: the 8-fold margin of the NTG.1 startup applies to the sources it
+ * samples alone, which the round trip is only in its own startup stage.
+ */
+static void jent_sched_health_init(struct rand_data *ec)
+{
+	unsigned int osr_quarters = JENT_OSR_QUARTERS(ec);
+
+	ec->sched_rct_cutoff = (unsigned short)
+		((JENT_HEALTH_RCT_INTERMITTENT_CUTOFF(osr_quarters) + 3) >> 2);
+	ec->sched_rct_cutoff_permanent = (unsigned short)
+		((JENT_HEALTH_RCT_PERMANENT_CUTOFF(osr_quarters) + 3) >> 2);
+	ec->sched_apt_cutoff = jent_health_cutoff(ec, jent_apt_cutoff_lookup,
+		JENT_ARRAY_SIZE(jent_apt_cutoff_lookup));
+	ec->sched_apt_cutoff_permanent = jent_health_cutoff(ec,
+		jent_apt_cutoff_permanent_lookup,
+		JENT_ARRAY_SIZE(jent_apt_cutoff_permanent_lookup));
+
+	ec->sched_rct_count = 0;
+	ec->sched_apt_base_set = 0;
+}
+
+/**
+ * Health tests of the scheduling noise source
+ *
+ * In the common operation the time of the scheduler round trip is measured
+ * separately from the time delta of the whole sample. It carries its own RCT
+ * and APT so that a scheduling source that went quiet is detected even though
+ * the sample it is part of still varies. They report their own failure bits,
+ * JENT_SCHED_RCT_FAILURE and JENT_SCHED_APT_FAILURE, so that a caller can tell
+ * the scheduler from the timer.
+ *
+ * A round trip time is stuck like a time delta in jent_stuck(): when it, its
+ * difference to the previous one or the difference of two such differences
+ * is zero. A scheduler that only ever takes a little longer each time is as
+ * predictable as one that takes the same time.
+ *
+ * @param[in] ec Reference to entropy collector
+ * @param[in] sched_delta Time of the scheduler round trip
+ *
+ * @return
+ * 	0 scheduler round trip time not stuck
+ * 	1 scheduler round trip time stuck
+ */
+unsigned int jent_sched_stuck(struct rand_data *ec, uint64_t sched_delta)
+{
+	uint64_t delta2 = jent_delta(ec->sched_last_delta, sched_delta);
+	uint64_t delta3 = jent_delta(ec->sched_last_delta2, delta2);
+	unsigned int stuck = !sched_delta || !delta2 || !delta3;
+	uint64_t apt_delta = sched_delta & JENT_APT_MASK;
+
+	ec->sched_last_delta = sched_delta;
+	ec->sched_last_delta2 = delta2;
+
+	/* RCT, see jent_rct_insert() */
+	if (stuck) {
+		ec->sched_rct_count++;
+
+		if (ec->sched_rct_count >= ec->sched_rct_cutoff_permanent)
+			ec->health_failure |= JENT_SCHED_RCT_FAILURE_PERMANENT;
+		else if (ec->sched_rct_count == ec->sched_rct_cutoff)
+			ec->health_failure |= JENT_SCHED_RCT_FAILURE;
+	} else {
+		ec->sched_rct_count = 0;
+	}
+
+	/* APT, see jent_apt_insert() */
+	if (!ec->sched_apt_base_set) {
+		ec->sched_apt_base = apt_delta;
+		ec->sched_apt_base_set = 1;
+		ec->sched_apt_count = 1;
+		ec->sched_apt_observations = 1;
+		return stuck;
+	}
+
+	if (apt_delta == ec->sched_apt_base) {
+		ec->sched_apt_count++;
+
+		if (ec->sched_apt_count >= ec->sched_apt_cutoff_permanent)
+			ec->health_failure |= JENT_SCHED_APT_FAILURE_PERMANENT;
+		else if (ec->sched_apt_count == ec->sched_apt_cutoff)
+			ec->health_failure |= JENT_SCHED_APT_FAILURE;
+	}
+
+	ec->sched_apt_observations++;
+	if (ec->sched_apt_observations >= JENT_APT_WINDOW_SIZE)
+		ec->sched_apt_base_set = 0;
+
+	return stuck;
+}
+
 /**
  * Insert an externally obtained time stamp into the health tests
  *
@@ -887,10 +1112,14 @@ unsigned int jent_health_insert_timestamp(struct rand_data *ec,
  *	2 APT failure
  *	4 Lag predictor test failure
  *	8 RCT with memory failure
+ *	16 RCT of the scheduling noise source failure
+ *	32 APT of the scheduling noise source failure
  *	1<<JENT_PERMANENT_FAILURE_SHIFT RCT permanent failure
  *	2<<JENT_PERMANENT_FAILURE_SHIFT APT permanent failure
  *	4<<JENT_PERMANENT_FAILURE_SHIFT Lag predictor test permanent failure
  *	8<<JENT_PERMANENT_FAILURE_SHIFT RCT with memory permanent failure
+ *	16<<JENT_PERMANENT_FAILURE_SHIFT scheduling RCT permanent failure
+ *	32<<JENT_PERMANENT_FAILURE_SHIFT scheduling APT permanent failure
  */
 unsigned int jent_health_failure(struct rand_data *ec)
 {
@@ -923,7 +1152,8 @@ void jent_health_init(struct rand_data *ec, enum jent_health_init_type inittype)
 {
 	/* Must start at zero to reach the correct cutoff value */
 	ec->rct_count = 0;
-	jent_lag_init(ec, ec->osr);
+	jent_sched_health_init(ec);
+	jent_lag_init(ec);
 	switch (inittype) {
 	case jent_health_init_type_ntg1:
 		jent_apt_init_ntg1(ec);
@@ -79,6 +79,7 @@ void jent_apt_duplicate(struct rand_data *new_ec, struct rand_data *old_ec);
 void jent_rct_duplicate(struct rand_data *new_ec);
 void jent_rct_mem_duplicate(struct rand_data *new_ec, struct rand_data *old_ec);
 unsigned int jent_stuck(struct rand_data *ec, uint64_t current_delta);
+unsigned int jent_sched_stuck(struct rand_data *ec, uint64_t sched_delta);
 /*
  * Insert an externally obtained time stamp into the health tests of @ec: the
  * delta against the previous stamp is formed as the noise source forms it and
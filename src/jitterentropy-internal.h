@@ -412,6 +412,21 @@ static inline uint64_t jent_umod64(uint64_t dividend, uint64_t divisor)
 #define JENT_HASH_LOOP_INIT 3
 #endif
 
+/*
+ * Scheduler round trips (jent_yield() calls) the scheduling noise source of
+ * JENT_SCHED_NOISE times for one time delta, at runtime and during its own
+ * startup stage. As with the loop counts above, the latter is the former
+ * tripled as the source is sampled alone there; use the jitterentropy-hashtime
+ * tool with --sched to measure it.
+ */
+#ifndef JENT_SCHED_LOOP_DEFAULT
+#define JENT_SCHED_LOOP_DEFAULT 1
+#endif
+
+#ifndef JENT_SCHED_LOOP_INIT
+#define JENT_SCHED_LOOP_INIT 3
+#endif
+
 /*
  * Oversampling rate: This value defines the default oversampling rate. The
  * OSR defines the global heuristic entropy rate of 1/OSR.
@@ -434,6 +449,52 @@ static inline uint64_t jent_umod64(uint64_t dividend, uint64_t divisor)
 #define JENT_MAX_OSR	20
 #endif
 
+/*
+ * The oversampling rate of a collector in quarters, including the fraction
+ * the JENT_OSR_PLUS_* flags add to ec->osr.
+ */
+#define JENT_OSR_QUARTERS(ec)						       \
+	((ec)->osr * 4 + JENT_FLAGS_TO_OSR_FRACTION((ec)->flags))
+
+/*
+ * Adaptive oversampling rate (JENT_ADAPTIVE_OSR): number of output blocks a
+ * collector raised by a health test recovery has to generate without another
+ * failure before jent_read_entropy_safe() probes one step back down.
+ *
+ * Each failed probe and each further recovery doubles the window of that
+ * collector, up to JENT_ADAPTIVE_OSR_WINDOW_MAX. This is the hysteresis: a
+ * host that keeps failing at the lower rate is probed less and less often
+ * instead of oscillating between the two. A successful step down keeps the
+ * window as it is.
+ *
+ * The default window is 8192 blocks, i.e. 256 kB of output.
+ */
+#ifndef JENT_ADAPTIVE_OSR_WINDOW
+#define JENT_ADAPTIVE_OSR_WINDOW	(UINT32_C(1) << 13)
+#endif
+
+#ifndef JENT_ADAPTIVE_OSR_WINDOW_MAX
+#define JENT_ADAPTIVE_OSR_WINDOW_MAX	(UINT32_C(1) << 20)
+#endif
+
+/*
+ * Latency controller (jent_set_latency_target()): the lowest memory access
+ * loop count it reduces a collector to, and the number of output blocks
+ * between two of its decisions. The hash loop count goes down to 1.
+ *
+ * NOTE: Like JENT_MEM_ACC_LOOP_DEFAULT, the minimum directly alters the
+ * behavior of the noise source. The health tests keep running at the
+ * collector's oversampling rate with the reduced counts, and the first failure
+ * restores the counts the collector was allocated with.
+ */
+#ifndef JENT_LATENCY_MEM_ACC_LOOP_MIN
+#define JENT_LATENCY_MEM_ACC_LOOP_MIN	(JENT_MEM_ACC_LOOP_DEFAULT / 4)
+#endif
+
+#ifndef JENT_LATENCY_WINDOW
+#define JENT_LATENCY_WINDOW		16
+#endif
+
 /***************************************************************************
  * Jitter RNG State Definition Section
  ***************************************************************************/
@@ -465,12 +526,26 @@ static inline uint64_t jent_umod64(uint64_t dividend, uint64_t divisor)
 enum jent_startup_state {
 	jent_startup_completed,
 	jent_startup_sha3,
-	jent_startup_memory
+	jent_startup_memory,
+	jent_startup_sched
 };
 
+struct jent_shared_mem;
+
 /* The entropy pool */
 struct rand_data
 {
+	/*
+	 * The fields are ordered by how often they are touched. The first part
+	 * is read and written for every time delta - by the noise sources, the
+	 * health tests and the conditioning - and starts the allocation, which
+	 * also holds the hash state right behind the structure and begins on a
+	 * cache line. The configuration and accounting used per output block or
+	 * less follow, and the counter the internal timer thread keeps writing
+	 * comes last, so that its stores do not take the lines of the first part
+	 * away from the core generating with them.
+	 */
+
 	/* all data values that are vital to maintain the security
 	 * of the RNG are marked as SENSITIVE. A user must not
 	 * access that information while the RNG executes its loops to
@@ -484,36 +559,11 @@ struct rand_data
 	uint64_t last_delta2;		/* SENSITIVE stuck test */
 #endif /* JENT_HEALTH_LAG_PREDICTOR */
 
-	unsigned int flags;		/* Flags used to initialize */
-	unsigned int osr;		/* Oversampling rate */
-
-	/* RFC 4122 version 4 identifier, stable for the collector's lifetime. */
-	char uuid[JENT_UUID_STRLEN];
-
-	/*
-	 * Number of times this instance has been reinitialized (reallocated on
-	 * health-test recovery). Carried over, incremented, across the identity-
-	 * preserving reallocation in jent_health_failure_reset().
-	 */
-	unsigned int reinit_count;
-
-	/*
-	 * Per-instance output accounting, reported by jent_status(). Both are
-	 * carried over across the identity-preserving reallocation in
-	 * jent_health_failure_reset() so the totals span the instance's whole
-	 * lifetime.
-	 *
-	 * read_invocations counts caller read requests: jent_read_entropy()
-	 * increments it only on success, so a jent_read_entropy_safe() request
-	 * maps to one invocation regardless of how many internal health-test
-	 * retries it takes (failed attempts never count).
-	 * bytes_output counts the random bytes actually delivered to callers.
-	 */
-	uint64_t read_invocations;
-	uint64_t bytes_output;
+	uint64_t jent_common_timer_gcd;	/* Common divisor for all time deltas */
 
-	/* Initialization state supporting AIS 20/31 NTG.1 */
-	enum jent_startup_state startup_state;
+#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
+	uint64_t notime_prev_timer;		/* previous timer value */
+#endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
 
 /* The step size should be larger than the cacheline size. */
 #ifndef JENT_MEMORY_BLOCKSIZE
@@ -526,11 +576,15 @@ struct rand_data
 
 	uint32_t memmask;		/* Memory mask (size of memory - 1) */
 	unsigned int memlocation; 	/* Pointer to byte in *mem */
+	unsigned int memstride;		/* Step of JENT_MEMACCESS_CACHE_STRIDE */
 	unsigned int memaccessloops;	/* Number of memory accesses per random
 					 * bit generation */
 
 	unsigned int hashloopcnt;	/* Hash loop count */
 
+	unsigned int flags;		/* Flags used to initialize */
+	unsigned int osr;		/* Oversampling rate */
+
 	/* Repetition Count Test */
 	unsigned int rct_count;		/* Number of stuck values */
 	unsigned short rct_cutoff;	/* RCT intermittent cutoff */
@@ -555,11 +609,42 @@ struct rand_data
 	unsigned short rct_mem_cutoff;	/* RCT intermittent cutoff */
 	unsigned short rct_mem_cutoff_permanent; /* RCT permanent cutoff */
 
+	/*
+	 * The samples collected for the current block, the deadline of
+	 * jent_read_entropy_timed() - a time stamp of the collector's time
+	 * source, 0 for none - and the samples jent_entropy_step() may still
+	 * take, 0 for no limit. A block either of them interrupts keeps its
+	 * samples and continues with the next call.
+	 */
+	unsigned short block_samples;
+	unsigned int step_samples;
+	uint64_t read_deadline;
+
+	/*
+	 * RCT and APT of the scheduling noise source (JENT_SCHED_NOISE) in the
+	 * common operation, where its time delta is part of a sample of the
+	 * other sources, see jent_sched_stuck().
+	 */
+	uint64_t sched_last_delta;	/* Previous scheduler round trip time */
+	uint64_t sched_last_delta2;	/* Previous difference of two of them */
+	uint64_t sched_apt_base;	/* APT base reference */
+	unsigned int sched_apt_cutoff;	/* APT intermittent cutoff */
+	unsigned int sched_apt_cutoff_permanent; /* APT permanent cutoff */
+	unsigned short sched_rct_cutoff; /* RCT intermittent cutoff */
+	unsigned short sched_rct_cutoff_permanent; /* RCT permanent cutoff */
+	unsigned int sched_rct_count;	/* Number of stuck values */
+	unsigned int sched_apt_count;	/* Occurrences of the base reference */
+	unsigned int sched_apt_observations; /* Observations in the window */
+
 	unsigned int apt_base_set:1;	/* APT base reference set? */
+	unsigned int sched_apt_base_set:1; /* Scheduling APT base set? */
 	unsigned int is_fips_enabled:1;
 	unsigned int enable_notime:1;	/* Use internal high-res timer */
 	unsigned int max_mem_set:1;	/* Maximum memory configured by user */
 	unsigned int in_recovery:1;	/* Flag to indicate a recovery op. */
+	unsigned int starting:1;	/* Startup has not completed yet */
+	unsigned int block_interrupted:1; /* Last block stopped short */
+	unsigned int block_ready:1;	/* Block of jent_entropy_step() waits */
 
 	/*
 	 * A jent_selftest() run bound to this instance failed. Deliberately
@@ -570,14 +655,8 @@ struct rand_data
 	 */
 	unsigned int selftest_failed:1;
 
-#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
-	volatile uint8_t notime_interrupt;	/* indicator to interrupt ctr */
-	volatile uint64_t notime_timer;		/* high-res timer mock-up */
-	uint64_t notime_prev_timer;		/* previous timer value */
-	void *notime_thread_ctx;		/* register thread data */
-#endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
-
-	uint64_t jent_common_timer_gcd;	/* Common divisor for all time deltas */
+	/* Initialization state supporting AIS 20/31 NTG.1 */
+	enum jent_startup_state startup_state;
 
 #ifdef JENT_HEALTH_LAG_PREDICTOR
 	/* Lag predictor test to look for re-occurring patterns. */
@@ -637,6 +716,104 @@ struct rand_data
 	/* The scoreboard that tracks how successful each predictor lag is. */
 	unsigned int lag_scoreboard[JENT_LAG_HISTORY_SIZE];
 #endif /* JENT_HEALTH_LAG_PREDICTOR */
+
+	/* Per output block, per collector or for jent_status() only */
+	/* RFC 4122 version 4 identifier, stable for the collector's lifetime. */
+	char uuid[JENT_UUID_STRLEN];
+
+	/*
+	 * Number of times this instance has been reinitialized (reallocated on
+	 * health-test recovery). Carried over, incremented, across the identity-
+	 * preserving reallocation in jent_health_failure_reset().
+	 */
+	unsigned int reinit_count;
+
+	/*
+	 * The fork generation the collector belongs to, see
+	 * jent_fork_generation(), and the times a fork() child told its copy
+	 * apart from the others in jent_read_entropy().
+	 */
+	uint32_t fork_generation;
+	unsigned int fork_rekeys;
+
+	/*
+	 * Outcome of the most recent OSR ladder search of
+	 * jent_health_failure_reset(), reported by jent_status(): the
+	 * configuration it settled on, how many candidates were put through the
+	 * power-up test to find it and how many of those ran at once. All zero
+	 * until the first recovery; carried over like reinit_count.
+	 */
+	unsigned int recovery_osr;
+	unsigned int recovery_flags;
+	unsigned int recovery_candidates;
+	unsigned int recovery_width;
+
+	/*
+	 * JENT_ADAPTIVE_OSR: the configuration the collector was allocated
+	 * with, which a step down never goes below, the blocks generated
+	 * since the last (re)allocation or probe, the number of clean blocks
+	 * required before the next probe and the step downs taken so far.
+	 * All but the block count are carried over across a reallocation.
+	 */
+	unsigned int osr_floor;
+	unsigned int flags_floor;
+	uint64_t adaptive_clean_blocks;
+	uint64_t adaptive_window;
+	unsigned int adaptive_step_downs;
+
+	/*
+	 * Latency controller: the target time of one output block, 0 when it
+	 * is off, the moving average of that time (both in the units of the
+	 * collector's time source), the loop counts the collector was
+	 * allocated with, which it never exceeds, the blocks since its last
+	 * decision and the decisions taken. The target and the decision counts
+	 * are carried over across a reallocation.
+	 */
+	uint64_t latency_target;
+	uint64_t latency_avg;
+	unsigned int latency_mem_loops_max;
+	unsigned int latency_hash_loops_max;
+	unsigned int latency_blocks;
+	unsigned int latency_reductions;
+	unsigned int latency_restorations;
+
+	/*
+	 * NUMA node jent_entropy_collector_bind_node() bound the collector to,
+	 * -1 when it is unbound. Carried over across a reallocation, which
+	 * binds the new memory to it again.
+	 */
+	int numa_node;
+
+	/*
+	 * Bytes of caller memory the collector was built in by
+	 * jent_entropy_collector_init(), 0 when the library allocated it. Such
+	 * a collector is wiped rather than freed, and never reallocated.
+	 */
+	size_t placed_len;
+
+	/*
+	 * Per-instance output accounting, reported by jent_status(). Both are
+	 * carried over across the identity-preserving reallocation in
+	 * jent_health_failure_reset() so the totals span the instance's whole
+	 * lifetime.
+	 *
+	 * read_invocations counts caller read requests: jent_read_entropy()
+	 * increments it only on success, so a jent_read_entropy_safe() request
+	 * maps to one invocation regardless of how many internal health-test
+	 * retries it takes (failed attempts never count).
+	 * bytes_output counts the random bytes actually delivered to callers.
+	 */
+	uint64_t read_invocations;
+	uint64_t bytes_output;
+
+	struct jent_shared_mem *shared_mem; /* Region mem is shared in, with
+					 * JENT_SHARED_MEMORY */
+
+#ifdef JENT_CONF_ENABLE_INTERNAL_TIMER
+	void *notime_thread_ctx;		/* register thread data */
+	volatile uint8_t notime_interrupt;	/* indicator to interrupt ctr */
+	volatile uint64_t notime_timer;		/* high-res timer mock-up */
+#endif /* JENT_CONF_ENABLE_INTERNAL_TIMER */
 };
 
 #ifdef __cplusplus
@@ -30,7 +30,7 @@
 /*
  * Structure of the intermediary buffer:
  *
- * | time delta | domain separator | hash loop hash | 0 ... |
+ * | time delta | domain separator | hash loop hash | scheduling delta | 0 ... |
  *
  * Note, this buffer is truncted to the current rate size which implies that
  * data with entropy must be placed at a location to guarantee they are not
@@ -39,9 +39,11 @@
 #define JENT_SIZEOF_TIMEDELTA		(sizeof(uint64_t))
 #define JENT_SIZEOF_DOMAINSEPARATOR	(sizeof(uint8_t))
 #define JENT_SIZEOF_HASH_BLOCK		(JENT_SHA3_256_SIZE_DIGEST)
+#define JENT_SIZEOF_SCHED_DELTA		(sizeof(uint64_t))
 #define JENT_SIZEOF_INTERMEDIARY_DATA	(JENT_SIZEOF_TIMEDELTA +               \
 					 JENT_SIZEOF_DOMAINSEPARATOR +         \
-					 JENT_SIZEOF_HASH_BLOCK)
+					 JENT_SIZEOF_HASH_BLOCK +              \
+					 JENT_SIZEOF_SCHED_DELTA)
 
 /* Intemediary is as big as the maximum rate it will be read with */
 #define JENT_SIZEOF_INTERMEDIARY	(JENT_SHA3_256_SIZE_BLOCK)
@@ -51,6 +53,17 @@
 	(JENT_OFFSET_TIMEDELTA + JENT_SIZEOF_TIMEDELTA)
 #define JENT_OFFSET_HASH_BLOCK                                                 \
 	(JENT_OFFSET_DOMAINSEPARATOR + JENT_SIZEOF_DOMAINSEPARATOR)
+#define JENT_OFFSET_SCHED_DELTA                                                \
+	(JENT_OFFSET_HASH_BLOCK + JENT_SIZEOF_HASH_BLOCK)
+
+/*
+ * The domain separator carries the phase in bits 0 and 1 (1 memory access
+ * only, 2 hash loop only, 3 both, 0 neither during the startup stage of the
+ * scheduling noise source), the hash loop kernel in bits 2 and 3, the memory
+ * access pattern in bits 4 to 6 and the presence of a scheduling delta in
+ * bit 7.
+ */
+#define JENT_SCHED_DOMAIN		0x80
 
 /**
  * Insert a data block into the entropy pool
@@ -104,27 +117,16 @@ static void jent_hash_insert(struct rand_data *ec, uint64_t time_delta,
  * 			     execution time jitter
  *
  * @param[in] ec entropy collector struct
- * @param[in] intermediary intermediary to be filled with the hash loop result
- *			   whose structure is defined above.
- * @param[in] loop_cnt if a value not equal to 0 is set, use the given value as
- *		       number of loops to perform the hash operation
+ * @param[in,out] digest the JENT_SHA3_256_SIZE_DIGEST bytes of the
+ *			 intermediary holding the hash loop result
+ * @param[in] hash_loop_cnt number of loops to perform the hash operation
  */
-static void jent_hash_loop(struct rand_data *ec,
-			   uint8_t intermediary[JENT_SIZEOF_INTERMEDIARY],
-			   uint64_t loop_cnt)
+static void jent_hash_loop_sha3(struct rand_data *ec, uint8_t *digest,
+				uint64_t hash_loop_cnt)
 {
 	HASH_CTX_ON_STACK(ctx);
-	uint8_t *digest = intermediary + JENT_OFFSET_HASH_BLOCK;
 	uint64_t j = 0;
 
-	/*
-	 * allow caller to set the counter
-	 */
-	uint64_t hash_loop_cnt = loop_cnt ? loop_cnt : ec->hashloopcnt;
-
-	JENT_BUILD_BUG_ON(JENT_HASH_LOOP_DEFAULT < 1);
-	JENT_BUILD_BUG_ON(JENT_HASH_LOOP_INIT < 1);
-
 	jent_sha3_256_init(&ctx);
 
 	/*
@@ -162,6 +164,173 @@ static void jent_hash_loop(struct rand_data *ec,
 	jent_memset_secure(&ctx, JENT_SHA_MAX_CTX_SIZE);
 }
 
+/*
+ * Operations one loop of the JENT_HASHKERNEL_MULDIV and JENT_HASHKERNEL_BRANCH
+ * kernels performs - roughly the time of the Keccak permutation one loop of the
+ * SHA3 kernel performs.
+ */
+#define JENT_HASHKERNEL_ROUNDS		512
+
+/* The hash loop result as the state of the kernels below */
+#define JENT_HASHKERNEL_WORDS		(JENT_SHA3_256_SIZE_DIGEST /           \
+					 sizeof(uint64_t))
+
+/*
+ * Seed of the kernels below. The hash loop starts from a zeroed intermediary
+ * on every sample, so like the SHA3 kernel mixing in the health test state
+ * they take their operands from what changes from one sample to the next: the
+ * time stamp of the sample and the health test state.
+ */
+static uint64_t jent_hashkernel_seed(const struct rand_data *ec)
+{
+	return ec->prev_time ^
+	       ec->apt_base ^
+	       ((uint64_t)ec->rct_count << 48) ^
+	       ((uint64_t)ec->apt_count << 32) ^
+	       ((uint64_t)ec->apt_observations << 16) ^
+	       ec->rct_mem_count;
+}
+
+/**
+ * Hash loop noise source with a multiply and divide chain
+ *
+ * Every operation depends on the result of the previous one. The latency of
+ * an integer division depends on its operands on most CPUs, so the chain
+ * collects the variations of the divider rather than the fixed schedule of
+ * the Keccak permutation.
+ *
+ * @param[in] ec entropy collector struct providing the seed
+ * @param[in,out] digest see jent_hash_loop_sha3
+ * @param[in] hash_loop_cnt see jent_hash_loop_sha3
+ */
+static void jent_hash_loop_muldiv(struct rand_data *ec, uint8_t *digest,
+				  uint64_t hash_loop_cnt)
+{
+	uint64_t state[JENT_HASHKERNEL_WORDS];
+	uint64_t j = 0, x;
+	unsigned int i;
+
+	memcpy(state, digest, sizeof(state));
+	x = state[0] ^ state[1] ^ jent_hashkernel_seed(ec);
+
+	for (j = 0; j < hash_loop_cnt; j++) {
+		for (i = 0; i < JENT_HASHKERNEL_ROUNDS; i++) {
+			uint64_t *word = &state[i % JENT_HASHKERNEL_WORDS];
+
+			x = x * UINT64_C(0x9e3779b97f4a7c15) + j + *word;
+			/* A divisor of at least 2^32 + 1 keeps it nonzero */
+			*word ^= jent_udiv64(x, (x >> 29) |
+						UINT64_C(0x100000001));
+		}
+		state[0] += x;
+	}
+
+	memcpy(digest, state, sizeof(state));
+	jent_memset_secure(state, sizeof(state));
+}
+
+/**
+ * Hash loop noise source with a branch-heavy mixer
+ *
+ * Each operation takes one of four paths chosen by the state it mixes. The
+ * branch predictor cannot learn the choices, so the timing collects the
+ * variations of the misprediction recovery of the CPU.
+ *
+ * @param[in] ec entropy collector struct providing the seed
+ * @param[in,out] digest see jent_hash_loop_sha3
+ * @param[in] hash_loop_cnt see jent_hash_loop_sha3
+ */
+static void jent_hash_loop_branch(struct rand_data *ec, uint8_t *digest,
+				  uint64_t hash_loop_cnt)
+{
+	uint64_t state[JENT_HASHKERNEL_WORDS];
+	uint64_t j = 0, x;
+	unsigned int i;
+
+	memcpy(state, digest, sizeof(state));
+	/* xorshift64 must not start at 0 */
+	x = (state[2] ^ state[3] ^ jent_hashkernel_seed(ec)) | 1;
+
+	for (j = 0; j < hash_loop_cnt; j++) {
+		for (i = 0; i < JENT_HASHKERNEL_ROUNDS; i++) {
+			uint64_t *word = &state[i % JENT_HASHKERNEL_WORDS];
+
+			/* xorshift64 */
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+
+			if (x & 1) {
+				*word += x;
+			} else if (x & 2) {
+				*word ^= x >> 3;
+			} else if (x & 4) {
+				*word = (*word << 9) | (*word >> 55);
+			} else {
+				*word -= x + j;
+			}
+		}
+	}
+
+	memcpy(digest, state, sizeof(state));
+	jent_memset_secure(state, sizeof(state));
+}
+
+/*
+ * The hash loop kernels, indexed by the JENT_HASHKERNEL_* flags field.
+ *
+ * Like the memory access patterns, the kernel index is mixed into the domain
+ * separator of the time deltas the hash loop contributes to, the SHA3 kernel
+ * leaving it as it always was.
+ */
+static const struct jent_hash_kernel {
+	void (*loop)(struct rand_data *ec, uint8_t *digest,
+		     uint64_t hash_loop_cnt);
+	const char *name;
+} jent_hash_kernels[] = {
+	{ jent_hash_loop_sha3,		"sha3" },
+	{ jent_hash_loop_muldiv,	"muldiv" },
+	{ jent_hash_loop_branch,	"branch" },
+};
+
+#define JENT_HASHKERNEL_DOMAIN(ec)                                             \
+	((uint8_t)(JENT_FLAGS_TO_HASHKERNEL((ec)->flags) << 2))
+
+const char *jent_hash_kernel_name(const struct rand_data *ec)
+{
+	unsigned int kernel = JENT_FLAGS_TO_HASHKERNEL(ec->flags);
+
+	if (kernel >= JENT_ARRAY_SIZE(jent_hash_kernels))
+		return "invalid";
+	return jent_hash_kernels[kernel].name;
+}
+
+/**
+ * Hash loop noise source -- invoke the kernel selected for the collector
+ *
+ * @param[in] ec entropy collector struct
+ * @param[in] intermediary intermediary to be filled with the hash loop result
+ *			   whose structure is defined above.
+ * @param[in] loop_cnt if a value not equal to 0 is set, use the given value as
+ *		       number of loops to perform the hash operation
+ */
+static void jent_hash_loop(struct rand_data *ec,
+			   uint8_t intermediary[JENT_SIZEOF_INTERMEDIARY],
+			   uint64_t loop_cnt)
+{
+	/*
+	 * allow caller to set the counter
+	 */
+	uint64_t hash_loop_cnt = loop_cnt ? loop_cnt : ec->hashloopcnt;
+
+	JENT_BUILD_BUG_ON(JENT_HASH_LOOP_DEFAULT < 1);
+	JENT_BUILD_BUG_ON(JENT_HASH_LOOP_INIT < 1);
+	JENT_BUILD_BUG_ON(JENT_SHA3_256_SIZE_DIGEST % sizeof(uint64_t));
+
+	jent_hash_kernels[JENT_FLAGS_TO_HASHKERNEL(ec->flags)].loop(
+		ec, intermediary + JENT_OFFSET_HASH_BLOCK, hash_loop_cnt);
+}
+
 static inline uint32_t uint32rotl(const uint32_t x, int k)
 {
 	return (x << k) | (x >> (32 - k));
@@ -341,6 +510,238 @@ static void jent_memaccess_deterministic(struct rand_data *ec,
 	}
 }
 
+/*
+ * Number of walks JENT_MEMACCESS_MULTISTREAM interleaves. They start evenly
+ * spaced in the memory block so that the misses of one walk can be outstanding
+ * while the others are served.
+ */
+#define JENT_MEMACCESS_STREAMS		4
+
+/**
+ * Memory Access noise source with a dependent pointer chase
+ *
+ * Like jent_memaccess_deterministic(), but the step to the next location
+ * depends on the value just written: the address of every access is only known
+ * once the previous access completed. The CPU can neither overlap the accesses
+ * nor can a prefetcher predict them, so every access pays its full latency.
+ *
+ * @param[in] ec see jent_memaccess_deterministic
+ * @param[in] loop_cnt see jent_memaccess_deterministic
+ * @param[in] current_delta see jent_memaccess_deterministic
+ */
+static void jent_memaccess_chase(struct rand_data *ec, uint64_t loop_cnt,
+				 uint64_t *current_delta)
+{
+	uint64_t time_now_start = 0, time_now_end = 0;
+	uint64_t i = 0, mem_loop_cnt;
+	unsigned int location;
+
+	if (NULL == ec || NULL == ec->mem)
+		return;
+
+	mem_loop_cnt = loop_cnt ? loop_cnt : ec->memaccessloops;
+	location = ec->memlocation;
+
+	if (current_delta)
+		jent_get_nstime_internal(ec, &time_now_start);
+
+	for (i = 0; i < mem_loop_cnt; i++) {
+		unsigned char *tmpval = ec->mem + location;
+		unsigned int val = (*tmpval + 1) & 0xff;
+
+		*tmpval = (unsigned char)val;
+
+		/*
+		 * The value moves the walk on by up to 255 blocks; the odd
+		 * remainder of the step keeps it from settling into a short
+		 * cycle when all values are equal.
+		 */
+		location = (location + JENT_MEMORY_BLOCKSIZE - 1 +
+			    val * JENT_MEMORY_BLOCKSIZE) & ec->memmask;
+	}
+
+	ec->memlocation = location;
+
+	if (current_delta) {
+		jent_get_nstime_internal(ec, &time_now_end);
+		*current_delta = jent_udiv64(jent_delta(time_now_start,
+							time_now_end),
+					     ec->jent_common_timer_gcd);
+	}
+}
+
+/**
+ * Memory Access noise source with a cache aliasing stride
+ *
+ * Like jent_memaccess_deterministic(), but consecutive accesses are
+ * ec->memstride bytes apart: the rounded up size of the largest cache below
+ * the size of the block - the L1 data cache, or all caches with JENT_CACHE_ALL
+ * where the block is larger - plus an odd remainder. Addresses that far apart
+ * map to the same sets of that cache, so a memory block larger than the cache
+ * evicts what the previous accesses loaded and every access misses that
+ * level.
+ *
+ * @param[in] ec see jent_memaccess_deterministic
+ * @param[in] loop_cnt see jent_memaccess_deterministic
+ * @param[in] current_delta see jent_memaccess_deterministic
+ */
+static void jent_memaccess_cache_stride(struct rand_data *ec,
+					uint64_t loop_cnt,
+					uint64_t *current_delta)
+{
+	uint64_t time_now_start = 0, time_now_end = 0;
+	uint64_t i = 0, mem_loop_cnt;
+	unsigned int location;
+
+	if (NULL == ec || NULL == ec->mem)
+		return;
+
+	mem_loop_cnt = loop_cnt ? loop_cnt : ec->memaccessloops;
+	location = ec->memlocation;
+
+	if (current_delta)
+		jent_get_nstime_internal(ec, &time_now_start);
+
+	for (i = 0; i < mem_loop_cnt; i++) {
+		unsigned char *tmpval = ec->mem + location;
+
+		*tmpval = (unsigned char)((*tmpval + 1) & 0xff);
+
+		/* An odd stride visits every byte of the power of 2 block */
+		location = (location + ec->memstride) & ec->memmask;
+	}
+
+	ec->memlocation = location;
+
+	if (current_delta) {
+		jent_get_nstime_internal(ec, &time_now_end);
+		*current_delta = jent_udiv64(jent_delta(time_now_start,
+							time_now_end),
+					     ec->jent_common_timer_gcd);
+	}
+}
+
+/**
+ * Memory Access noise source with interleaved walks
+ *
+ * JENT_MEMACCESS_STREAMS walks with the step of
+ * jent_memaccess_deterministic() take turns. Their accesses are independent of
+ * each other, so the CPU keeps several misses in flight and the timing picks up
+ * the contention for the memory subsystem rather than the latency of one
+ * access.
+ *
+ * @param[in] ec see jent_memaccess_deterministic
+ * @param[in] loop_cnt see jent_memaccess_deterministic - the total number of
+ *		       accesses of all walks, rounded up to a multiple of
+ *		       JENT_MEMACCESS_STREAMS
+ * @param[in] current_delta see jent_memaccess_deterministic
+ */
+static void jent_memaccess_multistream(struct rand_data *ec, uint64_t loop_cnt,
+				       uint64_t *current_delta)
+{
+	uint64_t time_now_start = 0, time_now_end = 0;
+	uint64_t i = 0, mem_loop_cnt;
+	unsigned int location, distance, stream;
+
+	if (NULL == ec || NULL == ec->mem)
+		return;
+
+	mem_loop_cnt = loop_cnt ? loop_cnt : ec->memaccessloops;
+	location = ec->memlocation;
+	distance = (ec->memmask + 1) / JENT_MEMACCESS_STREAMS;
+
+	if (current_delta)
+		jent_get_nstime_internal(ec, &time_now_start);
+
+	for (i = 0; i < mem_loop_cnt; i += JENT_MEMACCESS_STREAMS) {
+		for (stream = 0; stream < JENT_MEMACCESS_STREAMS; stream++) {
+			unsigned char *tmpval = ec->mem +
+				((location + stream * distance) & ec->memmask);
+
+			*tmpval = (unsigned char)((*tmpval + 1) & 0xff);
+		}
+
+		location = (location + JENT_MEMORY_BLOCKSIZE - 1) &
+			   ec->memmask;
+	}
+
+	ec->memlocation = location;
+
+	if (current_delta) {
+		jent_get_nstime_internal(ec, &time_now_end);
+		*current_delta = jent_udiv64(jent_delta(time_now_start,
+							time_now_end),
+					     ec->jent_common_timer_gcd);
+	}
+}
+
+/*
+ * The memory access patterns, indexed by the JENT_MEMACCESS_* flags field.
+ *
+ * The pattern index is mixed into the domain separator of every time delta a
+ * pattern other than JENT_MEMACCESS_DEFAULT contributes, so that the data one
+ * pattern inserts into the entropy pool never equals the data of another.
+ * JENT_MEMACCESS_DEFAULT keeps the separators the library always used.
+ */
+static const struct jent_memaccess_pattern {
+	void (*access)(struct rand_data *ec, uint64_t loop_cnt,
+		       uint64_t *current_delta);
+	const char *name;
+} jent_memaccess_patterns[] = {
+#ifdef JENT_RANDOM_MEMACCESS
+	{ jent_memaccess_pseudorandom,	"default (random)" },
+#else
+	{ jent_memaccess_deterministic,	"default (stride)" },
+#endif
+	{ jent_memaccess_deterministic,	"stride" },
+	{ jent_memaccess_pseudorandom,	"random" },
+	{ jent_memaccess_chase,		"chase" },
+	{ jent_memaccess_cache_stride,	"cache stride" },
+	{ jent_memaccess_multistream,	"multistream" },
+};
+
+#define JENT_MEMACCESS_DOMAIN(ec)                                              \
+	((uint8_t)(JENT_FLAGS_TO_MEMACCESS((ec)->flags) << 4))
+
+const char *jent_memaccess_name(const struct rand_data *ec)
+{
+	unsigned int pattern = JENT_FLAGS_TO_MEMACCESS(ec->flags);
+
+	if (pattern >= JENT_ARRAY_SIZE(jent_memaccess_patterns))
+		return "invalid";
+	return jent_memaccess_patterns[pattern].name;
+}
+
+/**
+ * Scheduling noise source -- this is the noise source based on the time of a
+ *			      round trip through the scheduler
+ *
+ * jent_yield() gives up the CPU and returns once the scheduler picked the
+ * caller again. The time this takes varies with the state of the run queues,
+ * the interrupts and the other tasks on the CPU, none of which the memory
+ * access and hash loop noise sources observe.
+ *
+ * @param[in] ec entropy collector struct
+ * @param[in] loop_cnt if a value not equal to 0 is set, use the given value as
+ *		       number of round trips
+ *
+ * @return time the round trips took
+ */
+static uint64_t jent_sched_loop(struct rand_data *ec, uint64_t loop_cnt)
+{
+	uint64_t time_now_start = 0, time_now_end = 0;
+	uint64_t j = 0;
+	uint64_t sched_loop_cnt = loop_cnt ? loop_cnt : JENT_SCHED_LOOP_DEFAULT;
+
+	jent_get_nstime_internal(ec, &time_now_start);
+	for (j = 0; j < sched_loop_cnt; j++)
+		jent_yield();
+	jent_get_nstime_internal(ec, &time_now_end);
+
+	return jent_udiv64(jent_delta(time_now_start, time_now_end),
+			   ec->jent_common_timer_gcd);
+}
+
 /***************************************************************************
  * Start of entropy processing logic
  ***************************************************************************/
@@ -361,7 +762,9 @@ unsigned int jent_measure_jitter_ntg1_memaccess(struct rand_data *ec,
 {
 	uint8_t intermediary[JENT_SIZEOF_INTERMEDIARY] = { 0 };
 	uint64_t current_delta = 0;
-	unsigned int stuck;
+	void (*access)(struct rand_data *ec, uint64_t loop_cnt,
+		       uint64_t *current_delta);
+	unsigned int pattern, stuck;
 
 	/*
 	 * Now call the memory noise source with tripple the default iteration
@@ -376,7 +779,8 @@ unsigned int jent_measure_jitter_ntg1_memaccess(struct rand_data *ec,
 	 * the L2, L3 caches or RAM. To ensure that as little as possible L1
 	 * operations are present, the xoshiro128starstar operation is not used.
 	 * The deterministic operation has less instructions and less L1
-	 * accesses. Therefore, the deterministic operation only is used here.
+	 * accesses. Therefore, the deterministic operation only is used here
+	 * unless the caller selected a JENT_MEMACCESS_* pattern explicitly.
 	 *
 	 * Furthermore, the increase of the memory access loop by 3 (the value
 	 * below is added to the original memory access loop) to ensure that
@@ -384,10 +788,59 @@ unsigned int jent_measure_jitter_ntg1_memaccess(struct rand_data *ec,
 	 * requirement of at least 240 bits of entropy from the L2/L3/RAM
 	 * accesses.
 	 */
-	jent_memaccess_deterministic(
-		ec, loop_cnt ? loop_cnt :
-			       ec->memaccessloops * JENT_MEM_ACC_LOOP_INIT,
-		&current_delta);
+	pattern = JENT_FLAGS_TO_MEMACCESS(ec->flags);
+	access = pattern ? jent_memaccess_patterns[pattern].access :
+			   jent_memaccess_deterministic;
+	access(ec, loop_cnt ? loop_cnt :
+			      ec->memaccessloops * JENT_MEM_ACC_LOOP_INIT,
+	       &current_delta);
+
+	/*
+	 * Check whether we have a stuck measurement - and apply the health
+	 * tests.
+	 */
+	stuck = jent_stuck(ec, current_delta);
+
+	/* Domain separation */
+	intermediary[JENT_OFFSET_DOMAINSEPARATOR] = 0x01 |
+						    JENT_MEMACCESS_DOMAIN(ec);
+
+	/* Insert the data into the entropy pool */
+	jent_hash_insert(ec, current_delta, intermediary);
+
+	/* return the raw entropy value */
+	if (ret_current_delta)
+		*ret_current_delta = current_delta;
+
+	return stuck;
+}
+
+/**
+ * This is the heart of the entropy generation for NTG.1 startup, invoking only
+ * the scheduling noise source: calculate time deltas and use the jitter in the
+ * time deltas. The jitter is injected into the entropy pool.
+ *
+ * @param[in] ec Reference to entropy collector
+ * @param[in] loop_cnt see jent_sched_loop
+ * @param[out] ret_current_delta Test interface: return time delta - may be NULL
+ *
+ * @return: result of stuck test
+ */
+unsigned int jent_measure_jitter_ntg1_sched(struct rand_data *ec,
+					    uint64_t loop_cnt,
+					    uint64_t *ret_current_delta)
+{
+	uint8_t intermediary[JENT_SIZEOF_INTERMEDIARY] = { 0 };
+	uint64_t current_delta;
+	unsigned int stuck;
+
+	/*
+	 * Tripple the default round trips considering this is the only noise
+	 * source, as for the other two.
+	 */
+	current_delta = jent_sched_loop(ec, loop_cnt ? loop_cnt :
+					    JENT_SCHED_LOOP_DEFAULT *
+					    JENT_SCHED_LOOP_INIT);
 
 	/*
 	 * Check whether we have a stuck measurement - and apply the health
@@ -396,7 +849,7 @@ unsigned int jent_measure_jitter_ntg1_memaccess(struct rand_data *ec,
 	stuck = jent_stuck(ec, current_delta);
 
 	/* Domain separation */
-	intermediary[JENT_OFFSET_DOMAINSEPARATOR] = 0x01;
+	intermediary[JENT_OFFSET_DOMAINSEPARATOR] = JENT_SCHED_DOMAIN;
 
 	/* Insert the data into the entropy pool */
 	jent_hash_insert(ec, current_delta, intermediary);
@@ -461,7 +914,8 @@ unsigned int jent_measure_jitter_ntg1_sha3(struct rand_data *ec,
 	stuck = jent_stuck(ec, current_delta);
 
 	/* Domain separation */
-	intermediary[JENT_OFFSET_DOMAINSEPARATOR] = 0x02;
+	intermediary[JENT_OFFSET_DOMAINSEPARATOR] = 0x02 |
+						    JENT_HASHKERNEL_DOMAIN(ec);
 
 	/* Insert the data into the entropy pool */
 	jent_hash_insert(ec, current_delta, intermediary);
@@ -496,15 +950,21 @@ unsigned int jent_measure_jitter(struct rand_data *ec,
 	uint8_t intermediary[JENT_SIZEOF_INTERMEDIARY] = { 0 };
 
 	uint64_t time_now = 0;
-	uint64_t current_delta = 0;
+	uint64_t current_delta = 0, sched_delta = 0;
 	unsigned int stuck;
 
 	/* Invoke memory access loop noise source */
-#ifdef JENT_RANDOM_MEMACCESS
-	jent_memaccess_pseudorandom(ec, loop_cnt, NULL);
-#else
-	jent_memaccess_deterministic(ec, loop_cnt, NULL);
-#endif
+	jent_memaccess_patterns[JENT_FLAGS_TO_MEMACCESS(ec->flags)].access(
+		ec, loop_cnt, NULL);
+
+	/*
+	 * Invoke the scheduling noise source. Its time is part of the time
+	 * delta below and is health tested on its own as well.
+	 */
+	if (ec->flags & JENT_SCHED_NOISE) {
+		sched_delta = jent_sched_loop(ec, 0);
+		jent_sched_stuck(ec, sched_delta);
+	}
 
 	/*
 	 * Get time stamp and calculate time delta to previous
@@ -522,7 +982,14 @@ unsigned int jent_measure_jitter(struct rand_data *ec,
 	jent_hash_loop(ec, intermediary, loop_cnt);
 
 	/* Domain separation */
-	intermediary[JENT_OFFSET_DOMAINSEPARATOR] = 0x03;
+	intermediary[JENT_OFFSET_DOMAINSEPARATOR] = 0x03 |
+						    JENT_HASHKERNEL_DOMAIN(ec) |
+						    JENT_MEMACCESS_DOMAIN(ec);
+	if (ec->flags & JENT_SCHED_NOISE) {
+		intermediary[JENT_OFFSET_DOMAINSEPARATOR] |= JENT_SCHED_DOMAIN;
+		memcpy(intermediary + JENT_OFFSET_SCHED_DELTA,
+		       (uint8_t *)&sched_delta, sizeof(uint64_t));
+	}
 
 	/* Insert the data into the entropy pool */
 	jent_hash_insert(ec, current_delta, intermediary);
@@ -535,11 +1002,12 @@ unsigned int jent_measure_jitter(struct rand_data *ec,
 }
 
 /*
- * We multiply the loop value with ->osr to obtain the oversampling rate
- * requested by the caller
+ * We multiply the loop value with the oversampling rate requested by the
+ * caller. That rate is given in quarters (JENT_OSR_QUARTERS) to cover the
+ * fraction of the JENT_OSR_PLUS_* flags.
  */
-#define JENT_MEASURE_JITTER_LOOP_CTR(_osr, _safety_factor)                     \
-	((DATA_SIZE_BITS + (_safety_factor)) * (_osr))
+#define JENT_MEASURE_JITTER_LOOP_CTR(_osr_quarters, _safety_factor)            \
+	(((DATA_SIZE_BITS + (_safety_factor)) * (_osr_quarters)) >> 2)
 
 /*
  * The health test RCT with memory operates on multiples of three time deltas.
@@ -547,9 +1015,9 @@ unsigned int jent_measure_jitter(struct rand_data *ec,
  */
 #define JENT_ROUNDUP_TO_THREE(x)                                               \
 	(jent_udiv64((x) + 2, 3) * 3)
-#define JENT_ADJUSTED_MEASURE_JITTER_LOOP_CTR(_osr, _safety_factor)            \
+#define JENT_ADJUSTED_MEASURE_JITTER_LOOP_CTR(_osr_quarters, _safety_factor)   \
 	JENT_ROUNDUP_TO_THREE(                                                 \
-		JENT_MEASURE_JITTER_LOOP_CTR(_osr, _safety_factor))
+		JENT_MEASURE_JITTER_LOOP_CTR(_osr_quarters, _safety_factor))
 
 static void jent_random_data_one(
 	struct rand_data *ec,
@@ -557,14 +1025,19 @@ static void jent_random_data_one(
 			               uint64_t loop_cnt,
 				       uint64_t *ret_current_delta))
 {
-	unsigned int safety_factor = 0, ctr = 0;
+	unsigned int safety_factor = 0;
 	uint64_t nosr;
 
 	if (ec->is_fips_enabled)
 		safety_factor = ENTROPY_SAFETY_FACTOR;
 
-	/* RCT with memory: start a new iteration loop */
-	ec->rct_mem_ctr = 0;
+	/*
+	 * RCT with memory: start a new iteration loop, unless the block
+	 * continues where a deadline interrupted it.
+	 */
+	if (!ec->block_samples)
+		ec->rct_mem_ctr = 0;
+	ec->block_interrupted = 0;
 
 	/*
 	 * Obtain number of loop iterations.
@@ -576,8 +1049,8 @@ static void jent_random_data_one(
 	 * count would silently shrink the RCT-with-memory window below what
 	 * the cutoff tables assume, disabling the health test.
 	 */
-	nosr = JENT_ADJUSTED_MEASURE_JITTER_LOOP_CTR((uint64_t)ec->osr,
-						     safety_factor);
+	nosr = JENT_ADJUSTED_MEASURE_JITTER_LOOP_CTR(
+			(uint64_t)JENT_OSR_QUARTERS(ec), safety_factor);
 	if (nosr > USHRT_MAX || nosr < DATA_SIZE_BITS) {
 		ec->health_failure |= JENT_RCT_MEM_FAILURE_PERMANENT;
 		return;
@@ -587,12 +1060,27 @@ static void jent_random_data_one(
 	/* Entropy collection loop */
 	while (!jent_health_failure(ec)) {
 		/* If a stuck measurement is received, repeat measurement */
-		if (measure_jitter(ec, 0, NULL))
-			continue;
+		if (!measure_jitter(ec, 0, NULL) &&
+		    ++ec->block_samples >= ec->rct_mem_nosr) {
+			ec->block_samples = 0;
+			return;
+		}
 
-		if (++ctr >= ec->rct_mem_nosr)
-			break;
+		/*
+		 * The deadline of jent_read_entropy_timed() passed or
+		 * jent_entropy_step() took its samples: keep them for the next
+		 * call. The time stamp of the last measurement is compared, so
+		 * no timer read is added to the loop.
+		 */
+		if ((ec->read_deadline && ec->prev_time >= ec->read_deadline) ||
+		    (ec->step_samples && !--ec->step_samples)) {
+			ec->block_interrupted = 1;
+			return;
+		}
 	}
+
+	/* A block that failed a health test is not continued */
+	ec->block_samples = 0;
 }
 
 /**
@@ -607,8 +1095,32 @@ void jent_random_data(struct rand_data *ec)
 	 * Select which noise source to use for the entropy collection
 	 */
 	switch (ec->startup_state) {
+	case jent_startup_sched:
+		jent_random_data_one(ec, jent_measure_jitter_ntg1_sched);
+
+		/*
+		 * A deadline or the end of a step interrupted the block of
+		 * this noise source: the next call continues it, in the same
+		 * state and with the same health tests.
+		 */
+		if (ec->block_interrupted)
+			return;
+		ec->startup_state = jent_startup_memory;
+
+		/*
+		 * Initialize the health tests as we fall through to
+		 * independently invoke the next noise source.
+		 */
+		jent_health_init(ec, ec->flags & JENT_NTG1 ?
+				     jent_health_init_type_ntg1 :
+				     jent_health_init_type_common);
+
+		JENT_FALLTHROUGH;
 	case jent_startup_memory:
 		jent_random_data_one(ec, jent_measure_jitter_ntg1_memaccess);
+		if (ec->block_interrupted)
+			return;
+
 		/*
 		 * Assign the successor state explicitly instead of
 		 * decrementing: a decrement based on the state observed
@@ -629,6 +1141,8 @@ void jent_random_data(struct rand_data *ec)
 		JENT_FALLTHROUGH;
 	case jent_startup_sha3:
 		jent_random_data_one(ec, jent_measure_jitter_ntg1_sha3);
+		if (ec->block_interrupted)
+			return;
 		ec->startup_state = jent_startup_completed;
 
 		/*
@@ -642,8 +1156,13 @@ void jent_random_data(struct rand_data *ec)
 		break;
 	case jent_startup_completed:
 	default:
-		/* priming of the ->prev_time value */
+		/*
+		 * priming of the ->prev_time value - one of the samples a step
+		 * may take, although the step still takes one of the block
+		 */
 		jent_measure_jitter(ec, 0, NULL);
+		if (ec->step_samples > 1)
+			ec->step_samples--;
 		jent_random_data_one(ec, jent_measure_jitter);
 	}
 }
@@ -652,3 +1171,10 @@ void jent_read_random_block(struct rand_data *ec, char *dst, size_t dst_len)
 {
 	jent_drbg_generate_block(ec->hash_state, (uint8_t*)dst, dst_len);
 }
+
+int jent_read_random_block_out(struct rand_data *ec, size_t dst_len,
+			       jent_drbg_out out, void *out_ctx)
+{
+	return jent_drbg_generate_block_out(ec->hash_state, dst_len, out,
+					    out_ctx);
+}
@@ -21,6 +21,7 @@
 #define JITTERENTROPY_NOISE_H
 
 #include "jitterentropy-internal.h"
+#include "jitterentropy-sha3.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -30,6 +31,9 @@ extern "C"
 unsigned int jent_measure_jitter_ntg1_memaccess(struct rand_data *ec,
 						uint64_t loop_cnt,
 						uint64_t *ret_current_delta);
+unsigned int jent_measure_jitter_ntg1_sched(struct rand_data *ec,
+					    uint64_t loop_cnt,
+					    uint64_t *ret_current_delta);
 unsigned int jent_measure_jitter_ntg1_sha3(struct rand_data *ec,
 					   uint64_t loop_cnt,
 					   uint64_t *ret_current_delta);
@@ -38,6 +42,10 @@ unsigned int jent_measure_jitter(struct rand_data *ec,
 				 uint64_t *ret_current_delta);
 void jent_random_data(struct rand_data *ec);
 void jent_read_random_block(struct rand_data *ec, char *dst, size_t dst_len);
+int jent_read_random_block_out(struct rand_data *ec, size_t dst_len,
+			       jent_drbg_out out, void *out_ctx);
+const char *jent_memaccess_name(const struct rand_data *ec);
+const char *jent_hash_kernel_name(const struct rand_data *ec);
 
 #ifdef __cplusplus
 }
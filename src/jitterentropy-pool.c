@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "jitterentropy.h"
+#include "jitterentropy-internal.h"
+
+/***************************************************************************
+ * Collector pool
+ *
+ * A pool holds up to its size of collectors that went through the complete
+ * startup of jent_entropy_collector_alloc(), so that jent_collector_pool_get()
+ * only has to take one off a stack. Collectors enter the pool in exactly two
+ * ways: freshly allocated by jent_collector_pool_refill(), or handed back by
+ * jent_collector_pool_put() in a good state. Both go through the lock, which
+ * also removes a collector from the stack before it is handed out, so no
+ * collector is ever held by the pool and a caller at the same time.
+ *
+ * The library starts no thread for the replenishment: the internal timer is
+ * the only thread it owns, and it has no primitive to wait on. The caller
+ * runs jent_collector_pool_refill() on a thread of its own - after a get, on a
+ * timer or in a loop of a worker - and that is where the startup time goes.
+ ***************************************************************************/
+
+/* The most collectors a pool holds */
+#define JENT_COLLECTOR_POOL_MAX	1024
+
+struct jent_collector_pool {
+	struct rand_data **ecs;	/* Ready collectors, ecs[0..count - 1] */
+	unsigned int size;	/* Collectors the pool is refilled to */
+	unsigned int count;	/* Collectors ready */
+	unsigned int osr;	/* Configuration the collectors are */
+	unsigned int flags;	/* allocated with */
+	unsigned int ec_osr;	/* What a started collector of it */
+	unsigned int ec_flags;	/* carries in ec->osr and ec->flags */
+	int locked;		/* Guards ecs and count */
+};
+
+static void jent_collector_pool_lock(struct jent_collector_pool *pool)
+{
+	while (jent_atomic_exchange_int(&pool->locked, 1))
+		;
+}
+
+static void jent_collector_pool_unlock(struct jent_collector_pool *pool)
+{
+	jent_atomic_store_int(&pool->locked, 0);
+}
+
+/*
+ * Put @ec on the stack if there is room.
+ *
+ * @return NULL when @ec was taken, @ec otherwise
+ */
+static struct rand_data *jent_collector_pool_push(
+	struct jent_collector_pool *pool, struct rand_data *ec)
+{
+	unsigned int i;
+
+	jent_collector_pool_lock(pool);
+	for (i = 0; i < pool->count; i++) {
+		/* Already in the pool: taking it twice would hand it out twice */
+		if (pool->ecs[i] == ec) {
+			jent_collector_pool_unlock(pool);
+			return NULL;
+		}
+	}
+	if (pool->count < pool->size) {
+		pool->ecs[pool->count++] = ec;
+		ec = NULL;
+	}
+	jent_collector_pool_unlock(pool);
+
+	return ec;
+}
+
+JENT_PRIVATE_STATIC
+int jent_collector_pool_refill(struct jent_collector_pool *pool)
+{
+	struct rand_data *ec;
+	unsigned int missing;
+
+	if (!pool)
+		return -EINVAL;
+
+	for (;;) {
+		jent_collector_pool_lock(pool);
+		missing = pool->size - pool->count;
+		jent_collector_pool_unlock(pool);
+
+		if (!missing)
+			return 0;
+
+		/* The startup runs outside the lock */
+		ec = jent_entropy_collector_alloc(pool->osr, pool->flags);
+		if (!ec)
+			return -ENOMEM;
+
+		/* Returned collectors filled the pool in the meantime */
+		ec = jent_collector_pool_push(pool, ec);
+		if (ec) {
+			jent_entropy_collector_free(ec);
+			return 0;
+		}
+	}
+}
+
+JENT_PRIVATE_STATIC
+struct jent_collector_pool *jent_collector_pool_alloc(unsigned int size,
+						      unsigned int osr,
+						      unsigned int flags)
+{
+	struct jent_collector_pool *pool;
+
+	if (!size || size > JENT_COLLECTOR_POOL_MAX)
+		return NULL;
+
+	pool = jent_zalloc(sizeof(struct jent_collector_pool), 0);
+	if (!pool)
+		return NULL;
+
+	pool->ecs = jent_zalloc(size * sizeof(struct rand_data *), 0);
+	if (!pool->ecs) {
+		jent_zfree(pool, sizeof(struct jent_collector_pool));
+		return NULL;
+	}
+
+	pool->size = size;
+	pool->osr = osr;
+	pool->flags = flags;
+
+	if (jent_collector_pool_refill(pool)) {
+		jent_collector_pool_free(pool);
+		return NULL;
+	}
+
+	/*
+	 * The allocation normalizes the OSR and the flags, so what a returned
+	 * collector is compared against is taken from one that just started.
+	 */
+	pool->ec_osr = pool->ecs[0]->osr;
+	pool->ec_flags = pool->ecs[0]->flags;
+
+	return pool;
+}
+
+JENT_PRIVATE_STATIC
+struct rand_data *jent_collector_pool_get(struct jent_collector_pool *pool)
+{
+	struct rand_data *ec = NULL;
+
+	if (!pool)
+		return NULL;
+
+	jent_collector_pool_lock(pool);
+	if (pool->count) {
+		ec = pool->ecs[--pool->count];
+		pool->ecs[pool->count] = NULL;
+	}
+	jent_collector_pool_unlock(pool);
+
+	/* Empty: the caller waits for the startup as without a pool */
+	if (!ec)
+		ec = jent_entropy_collector_alloc(pool->osr, pool->flags);
+
+	return ec;
+}
+
+JENT_PRIVATE_STATIC
+void jent_collector_pool_put(struct jent_collector_pool *pool,
+			     struct rand_data *ec)
+{
+	if (!ec)
+		return;
+
+	/*
+	 * A collector that failed a health test or its self test is not
+	 * handed to the next caller; nor is one that has not completed its
+	 * startup, nor one the pool has no room for. Nor is one of another
+	 * configuration: from another pool, or with the OSR or flags a
+	 * recovery raised or a step down lowered.
+	 */
+	if (pool && !ec->health_failure && !ec->selftest_failed &&
+	    !ec->starting && ec->osr == pool->ec_osr &&
+	    ec->flags == pool->ec_flags) {
+		/*
+		 * What the last caller left behind is not for the next one: a
+		 * block begun or completed by jent_entropy_step() or cut short
+		 * by a deadline, and loop counts its latency target lowered.
+		 */
+		ec->block_ready = 0;
+		ec->block_samples = 0;
+		ec->block_interrupted = 0;
+		ec->step_samples = 0;
+		ec->read_deadline = 0;
+		jent_set_latency_target(ec, 0);
+
+		ec = jent_collector_pool_push(pool, ec);
+	}
+
+	jent_entropy_collector_free(ec);
+}
+
+JENT_PRIVATE_STATIC
+unsigned int jent_collector_pool_count(struct jent_collector_pool *pool)
+{
+	unsigned int count;
+
+	if (!pool)
+		return 0;
+
+	jent_collector_pool_lock(pool);
+	count = pool->count;
+	jent_collector_pool_unlock(pool);
+
+	return count;
+}
+
+JENT_PRIVATE_STATIC
+void jent_collector_pool_free(struct jent_collector_pool *pool)
+{
+	unsigned int i;
+
+	if (!pool)
+		return;
+
+	for (i = 0; i < pool->count; i++)
+		jent_entropy_collector_free(pool->ecs[i]);
+
+	jent_zfree(pool->ecs, pool->size * sizeof(struct rand_data *));
+	jent_zfree(pool, sizeof(struct jent_collector_pool));
+}
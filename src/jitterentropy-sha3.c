@@ -410,12 +410,14 @@ void jent_sha3_dealloc(void *hash_state)
 /*
  * This operation implements XDRBG-256 as defined in [1].
  *
- * The output size is [0:256] bits.
+ * The output size is [0:256] bits. It is copied to dst, or with out set handed
+ * to out where it is generated, and the return value of out is returned.
  *
  * [1] https://leancrypto.org/papers/xdrbg.pdf
  */
-static void jent_xdrbg256_generate_block(struct jent_sha_ctx *ctx, uint8_t *dst,
-					 size_t dst_len)
+static int jent_xdrbg256_generate_block(struct jent_sha_ctx *ctx, uint8_t *dst,
+					size_t dst_len, jent_drbg_out out,
+					void *out_ctx)
 {
 	/*
 	 * XDRBG:
@@ -424,6 +426,7 @@ static void jent_xdrbg256_generate_block(struct jent_sha_ctx *ctx, uint8_t *dst,
 	uint8_t jent_block_next_state[JENT_XDRBG_SIZE_STATE +
 				      JENT_SHA3_256_SIZE_DIGEST];
 	uint8_t encode;
+	int ret = 0;
 
 	/* Checking the output size */
 	JENT_BUILD_BUG_ON(JENT_SHA3_256_SIZE_DIGEST != ((DATA_SIZE_BITS / 8)));
@@ -480,29 +483,51 @@ static void jent_xdrbg256_generate_block(struct jent_sha_ctx *ctx, uint8_t *dst,
 	jent_shake256_set_digestsize(ctx, sizeof(jent_block_next_state));
 	jent_sha3_final(ctx, jent_block_next_state);
 
+	/*
+	 * XDRBG: reseed
+	 * Set the V into the state before Σ leaves this function, so that the
+	 * state is complete while out runs caller code, and V is gone from the
+	 * stack by then.
+	 */
+	jent_sha3_update(ctx, jent_block_next_state, JENT_XDRBG_SIZE_STATE);
+	jent_memset_secure(jent_block_next_state, JENT_XDRBG_SIZE_STATE);
+
 	/* Return Σ to the caller truncated to the requested size */
 	if (dst_len)  {
 		/* Safety measure to not overflow the generated buffer */
 		if (dst_len > JENT_SHA3_256_SIZE_DIGEST)
 			dst_len = JENT_SHA3_256_SIZE_DIGEST;
 
-		memcpy(dst, jent_block_next_state + JENT_XDRBG_SIZE_STATE,
-		       dst_len);
+		/*
+		 * A consumer of its own reads Σ in place: it never exists
+		 * outside this buffer, which is wiped below anyway.
+		 */
+		if (out)
+			ret = out(out_ctx,
+				  jent_block_next_state + JENT_XDRBG_SIZE_STATE,
+				  dst_len);
+		else
+			memcpy(dst,
+			       jent_block_next_state + JENT_XDRBG_SIZE_STATE,
+			       dst_len);
 	}
 
-	/*
-	 * XDRBG: reseed
-	 * Set the V into the state.
-	 */
-	jent_sha3_update(ctx, jent_block_next_state, JENT_XDRBG_SIZE_STATE);
 	jent_memset_secure(jent_block_next_state,
 			   sizeof(jent_block_next_state));
+
+	return ret;
 }
 
 void jent_drbg_generate_block(struct jent_sha_ctx *ctx, uint8_t *dst,
 			      size_t dst_len)
 {
-	jent_xdrbg256_generate_block(ctx, dst, dst_len);
+	jent_xdrbg256_generate_block(ctx, dst, dst_len, NULL, NULL);
+}
+
+int jent_drbg_generate_block_out(struct jent_sha_ctx *ctx, size_t dst_len,
+				 jent_drbg_out out, void *out_ctx)
+{
+	return jent_xdrbg256_generate_block(ctx, NULL, dst_len, out, out_ctx);
 }
 
 /********************************** Selftest **********************************/
@@ -568,10 +593,10 @@ static int jent_xdrbg256_tester(void)
 	jent_shake256_init(&ctx);
 	/* Initial seed */
 	jent_sha3_update(&ctx, seed, sizeof(seed));
-	jent_xdrbg256_generate_block(&ctx, act, sizeof(act));
+	jent_xdrbg256_generate_block(&ctx, act, sizeof(act), NULL, NULL);
 	/* Reseeding */
 	jent_sha3_update(&ctx, seed, sizeof(seed));
-	jent_xdrbg256_generate_block(&ctx, act, sizeof(act));
+	jent_xdrbg256_generate_block(&ctx, act, sizeof(act), NULL, NULL);
 
 	for (i = 0; i < sizeof(exp); i++) {
 		if (exp[i] != act[i])
@@ -76,6 +76,10 @@ static inline void jent_shake256_set_digestsize(struct jent_sha_ctx *ctx,
 }
 void jent_drbg_generate_block(struct jent_sha_ctx *ctx, uint8_t *dst,
 			      size_t dst_len);
+/* Hand a block to out instead of copying it, returning what out returns */
+typedef int (*jent_drbg_out)(void *ctx, const uint8_t *data, size_t len);
+int jent_drbg_generate_block_out(struct jent_sha_ctx *ctx, size_t dst_len,
+				 jent_drbg_out out, void *out_ctx);
 
 #ifdef __cplusplus
 }
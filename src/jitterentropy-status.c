@@ -20,6 +20,7 @@
 #include "jitterentropy.h"
 #include "jitterentropy-base.h"
 #include "jitterentropy-internal.h"
+#include "jitterentropy-noise.h"
 
 #ifdef LINUX_KERNEL
 /*
@@ -86,6 +87,48 @@ int jent_status(const struct rand_data *ec, char *buf, size_t buflen)
 	/* number of reinitializations (reallocations on health-test recovery) */
 	jent_add_to_status("\t\"reinitializations\": %u,\n", ec->reinit_count);
 
+	/* times a fork() child rekeyed its copy of the collector */
+	jent_add_to_status("\t\"forkRekeys\": %u,\n", ec->fork_rekeys);
+
+	/*
+	 * configuration chosen by the most recent recovery, all zero until
+	 * there was one
+	 */
+	jent_add_to_status("\t\"recovery\": {\n");
+	jent_add_to_status("\t\t\"osr\": %u,\n", ec->recovery_osr);
+	jent_add_to_status("\t\t\"memoryBlockSizeBytes\": %u,\n",
+			   ec->recovery_candidates ?
+			   jent_memsize(ec->recovery_flags) : 0);
+	jent_add_to_status("\t\t\"hashLoopCount\": %u,\n",
+			   ec->recovery_candidates ?
+			   jent_hashloop_cnt(ec->recovery_flags) : 0);
+	jent_add_to_status("\t\t\"candidatesTested\": %u,\n",
+			   ec->recovery_candidates);
+	jent_add_to_status("\t\t\"parallelCandidates\": %u,\n",
+			   ec->recovery_width);
+	jent_add_to_status("\t\t\"osrFloor\": %u,\n", ec->osr_floor);
+	jent_add_to_status("\t\t\"stepDowns\": %u\n",
+			   ec->adaptive_step_downs);
+	jent_add_to_status("\t},\n");
+
+	/*
+	 * latency controller, see jent_set_latency_target(); the loop counts
+	 * are the ones in use
+	 */
+	jent_add_to_status("\t\"latencyControl\": {\n");
+	jent_add_to_status("\t\t\"targetBlockTime\": %llu,\n",
+			   (unsigned long long)ec->latency_target);
+	jent_add_to_status("\t\t\"averageBlockTime\": %llu,\n",
+			   (unsigned long long)ec->latency_avg);
+	jent_add_to_status("\t\t\"memoryLoopCount\": %u,\n",
+			   ec->memaccessloops);
+	jent_add_to_status("\t\t\"hashLoopCount\": %u,\n", ec->hashloopcnt);
+	jent_add_to_status("\t\t\"reductions\": %u,\n",
+			   ec->latency_reductions);
+	jent_add_to_status("\t\t\"restorations\": %u\n",
+			   ec->latency_restorations);
+	jent_add_to_status("\t},\n");
+
 	/*
 	 * output accounting over the instance's lifetime
 	 */
@@ -122,6 +165,20 @@ int jent_status(const struct rand_data *ec, char *buf, size_t buflen)
 			   ec->health_failure & JENT_RCT_MEM_FAILURE ? "true" : "false");
 	jent_add_to_status("\t\t\t\"permanent\": %s\n",
 			   ec->health_failure & JENT_RCT_MEM_FAILURE_PERMANENT ? "true" : "false");
+	jent_add_to_status("\t\t},\n");
+
+	jent_add_to_status("\t\t\"schedRct\": {\n");
+	jent_add_to_status("\t\t\t\"intermittent\": %s,\n",
+			   ec->health_failure & JENT_SCHED_RCT_FAILURE ? "true" : "false");
+	jent_add_to_status("\t\t\t\"permanent\": %s\n",
+			   ec->health_failure & JENT_SCHED_RCT_FAILURE_PERMANENT ? "true" : "false");
+	jent_add_to_status("\t\t},\n");
+
+	jent_add_to_status("\t\t\"schedApt\": {\n");
+	jent_add_to_status("\t\t\t\"intermittent\": %s,\n",
+			   ec->health_failure & JENT_SCHED_APT_FAILURE ? "true" : "false");
+	jent_add_to_status("\t\t\t\"permanent\": %s\n",
+			   ec->health_failure & JENT_SCHED_APT_FAILURE_PERMANENT ? "true" : "false");
 	jent_add_to_status("\t\t}");
 
 #ifdef JENT_HEALTH_LAG_PREDICTOR
@@ -158,7 +215,10 @@ int jent_status(const struct rand_data *ec, char *buf, size_t buflen)
 	jent_add_to_status( "\t\"configuration\": {\n");
 
 	jent_add_to_status( "\t\t\"osr\": %u,\n", ec->osr);
+	jent_add_to_status( "\t\t\"osrQuarters\": %u,\n", JENT_OSR_QUARTERS(ec));
 	jent_add_to_status( "\t\t\"memoryBlockSizeBytes\": %u,\n", jent_memsize(ec->flags));
+	jent_add_to_status( "\t\t\"memoryAccessPattern\": \"%s\",\n", jent_memaccess_name(ec));
+	jent_add_to_status( "\t\t\"hashKernel\": \"%s\",\n", jent_hash_kernel_name(ec));
 
 	jent_add_to_status("\t\t\"hashLoopCount\": {\n");
 	jent_add_to_status("\t\t\t\"runtime\": %u,\n", jent_hashloop_cnt(ec->flags));
@@ -170,8 +230,19 @@ int jent_status(const struct rand_data *ec, char *buf, size_t buflen)
 	jent_add_to_status("\t\t\t\"initialization\": %u\n", ec->memaccessloops * JENT_MEM_ACC_LOOP_INIT);
 	jent_add_to_status("\t\t},\n");
 
-	jent_add_to_status("\t\t\"secureMemory\": %s,\n", jent_memory_is_secure(ec->flags) ? "true" : "false");
+	/* Caller memory is only as secure as the caller made it */
+	jent_add_to_status("\t\t\"secureMemory\": %s,\n", !ec->placed_len && jent_memory_is_secure(ec->flags) ? "true" : "false");
+	jent_add_to_status("\t\t\"callerMemory\": %s,\n", ec->placed_len ? "true" : "false");
+	jent_add_to_status("\t\t\"starting\": %s,\n", ec->starting ? "true" : "false");
 	jent_add_to_status("\t\t\"internalTimer\": %s,\n", ec->enable_notime ? "true" : "false");
+	jent_add_to_status("\t\t\"schedulingNoise\": %s,\n", (ec->flags & JENT_SCHED_NOISE) ? "true" : "false");
+
+	/* -1: unbound, respectively unknown */
+	jent_add_to_status("\t\t\"numa\": {\n");
+	jent_add_to_status("\t\t\t\"boundNode\": %d,\n", ec->numa_node);
+	jent_add_to_status("\t\t\t\"memoryNode\": %d,\n", ec->mem ? jent_memory_node(ec->mem) : -1);
+	jent_add_to_status("\t\t\t\"hashStateNode\": %d\n", jent_memory_node(ec->hash_state));
+	jent_add_to_status("\t\t},\n");
 	/*
 	 * Whether this build can have its time source replaced by the caller -
 	 * a property of the build, not of whether a callback is registered
@@ -201,8 +272,14 @@ int jent_status(const struct rand_data *ec, char *buf, size_t buflen)
 		 !!(ec->flags & JENT_NTG1) ? "true" : "false");
 	jent_add_to_status("\t\t\t\"JENT_CACHE_ALL\": %s,\n",
 		 !!(ec->flags & JENT_CACHE_ALL) ? "true" : "false");
-	jent_add_to_status("\t\t\t\"JENT_FORCE_SECURE_MEM\": %s\n",
+	jent_add_to_status("\t\t\t\"JENT_FORCE_SECURE_MEM\": %s,\n",
 		 !!(ec->flags & JENT_FORCE_SECURE_MEM) ? "true" : "false");
+	jent_add_to_status("\t\t\t\"JENT_ADAPTIVE_OSR\": %s,\n",
+		 !!(ec->flags & JENT_ADAPTIVE_OSR) ? "true" : "false");
+	jent_add_to_status("\t\t\t\"JENT_HUGE_PAGES\": %s,\n",
+		 !!(ec->flags & JENT_HUGE_PAGES) ? "true" : "false");
+	jent_add_to_status("\t\t\t\"JENT_SHARED_MEMORY\": %s\n",
+		 !!(ec->flags & JENT_SHARED_MEMORY) ? "true" : "false");
 	jent_add_to_status("\t\t}\n");
 	jent_add_to_status("\t}\n");
 
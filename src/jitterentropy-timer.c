@@ -301,6 +301,57 @@ void jent_notime_disable(struct rand_data *ec)
 		notime_thread->jent_notime_fini(ec->notime_thread_ctx);
 }
 
+/*
+ * Run routine(arg) on a thread of its own, for work that is not a counter.
+ *
+ * The thread comes from the same handler as the counting thread, so a
+ * consumer that registered one via jent_entropy_switch_notime_impl() - the
+ * kernel, a baremetal scheduler - provides these threads as well, and a
+ * build without any gets the error return and has the caller do the work
+ * inline. The builtin handler refuses on fewer than two CPUs, where a
+ * worker would only compete with the caller for the one there is.
+ *
+ * The routine must return on its own; jent_notime_worker_join() waits for
+ * that and releases the thread.
+ *
+ * Returns 0 on success, a negative value if no thread could be started.
+ */
+int jent_notime_worker_start(void **ctx, jent_notime_start_routine routine,
+			     void *arg, unsigned int flags)
+{
+	int ret;
+
+	*ctx = NULL;
+
+	if (!notime_thread)
+		return -EINVAL;
+
+	if (notime_thread == &jent_notime_thread_builtin)
+		ret = jent_notime_init_flags(ctx, flags);
+	else
+		ret = notime_thread->jent_notime_init(ctx);
+	if (ret)
+		return ret < 0 ? ret : -ret;
+
+	ret = notime_thread->jent_notime_start(*ctx, routine, arg);
+	if (ret) {
+		notime_thread->jent_notime_fini(*ctx);
+		*ctx = NULL;
+		return ret < 0 ? ret : -ret;
+	}
+
+	return 0;
+}
+
+void jent_notime_worker_join(void *ctx)
+{
+	if (!notime_thread || !ctx)
+		return;
+
+	notime_thread->jent_notime_stop(ctx);
+	notime_thread->jent_notime_fini(ctx);
+}
+
 int jent_notime_enable(struct rand_data *ec, unsigned int flags)
 {
 	/*
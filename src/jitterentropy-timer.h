@@ -36,6 +36,9 @@ void jent_notime_unsettick(struct rand_data *ec);
 void jent_get_nstime_internal(struct rand_data *ec, uint64_t *out);
 int jent_notime_enable(struct rand_data *ec, unsigned int flags);
 void jent_notime_disable(struct rand_data *ec);
+int jent_notime_worker_start(void **ctx, jent_notime_start_routine routine,
+			     void *arg, unsigned int flags);
+void jent_notime_worker_join(void *ctx);
 int jent_notime_switch(struct jent_notime_thread *new_thread);
 void jent_notime_force(void);
 int jent_notime_forced(void);
@@ -312,6 +312,8 @@ int main(int argc, char *argv[])
 			{ "apt",	JENT_APT_FAILURE },
 			{ "rct",	JENT_RCT_FAILURE },
 			{ "rctMemory",	JENT_RCT_MEM_FAILURE },
+			{ "schedRct",	JENT_SCHED_RCT_FAILURE },
+			{ "schedApt",	JENT_SCHED_APT_FAILURE },
 			{ "lag",	JENT_LAG_FAILURE },
 		};
 		size_t i;
@@ -109,6 +109,10 @@ static const struct jent_test_bit jent_test_bits[] = {
 	{ JENT_APT_FAILURE_PERMANENT,	"APT-permanent" },
 	{ JENT_LAG_FAILURE_PERMANENT,	"Lag-permanent" },
 	{ JENT_RCT_MEM_FAILURE_PERMANENT, "RCT-mem-permanent" },
+	{ JENT_SCHED_RCT_FAILURE,	"sched-RCT" },
+	{ JENT_SCHED_APT_FAILURE,	"sched-APT" },
+	{ JENT_SCHED_RCT_FAILURE_PERMANENT, "sched-RCT-permanent" },
+	{ JENT_SCHED_APT_FAILURE_PERMANENT, "sched-APT-permanent" },
 };
 
 static void jent_test_print_mask(unsigned int mask)
@@ -35,6 +35,7 @@
  * jitterentropy.h happens to include these itself, but a consumer does not get
  * to rely on that, and this program is written the way a consumer would be.
  */
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -47,6 +48,14 @@ static void fips_failure(struct rand_data *ec, unsigned int health_failure)
 	fips_failure_seen = health_failure;
 }
 
+/* Counts what jent_read_entropy_stream() hands over. */
+static int stream_sink(void *ctx, const char *data, size_t len)
+{
+	(void)data;
+	*(size_t *)ctx += len;
+	return 0;
+}
+
 #define FAIL(...)						\
 	do {							\
 		fprintf(stderr, "FAILED: " __VA_ARGS__);	\
@@ -56,12 +65,16 @@ static void fips_failure(struct rand_data *ec, unsigned int health_failure)
 
 int main(void)
 {
-	struct rand_data *ec;
+	struct jent_collector_pool *pool;
+	struct jent_drbg_child *child;
+	struct rand_data *ec, *pooled;
 	void *notime_ctx = NULL;
 	char status[4096];
 	char uuid[JENT_UUID_STRLEN];
 	char data[32];
-	unsigned int version;
+	struct jent_iovec iov[2];
+	size_t streamed;
+	unsigned int version, tuned_osr = 0, tuned_flags = 0;
 	ssize_t rc;
 	int ret;
 
@@ -139,6 +152,20 @@ int main(void)
 	if (!ret)
 		jent_notime_fini(notime_ctx);
 
+	/*
+	 * The autotuning benchmarks the host, so its choice is reported
+	 * rather than asserted; what it returns has to allocate, though.
+	 */
+	ret = jent_autotune(&tuned_osr, &tuned_flags);
+	printf("jent_autotune: %d (osr %u, flags 0x%x)\n", ret, tuned_osr,
+	       tuned_flags);
+	if (!ret) {
+		ec = jent_entropy_collector_alloc(tuned_osr, tuned_flags);
+		if (!ec)
+			FAIL("jent_entropy_collector_alloc rejected the profile of jent_autotune");
+		jent_entropy_collector_free(ec);
+	}
+
 	ec = jent_entropy_collector_alloc(0, 0);
 	if (!ec)
 		FAIL("jent_entropy_collector_alloc returned NULL");
@@ -155,6 +182,94 @@ int main(void)
 	if (rc != (ssize_t)sizeof(data))
 		FAIL("jent_read_entropy_safe: %ld", (long)rc);
 
+	/* A budget that cannot run out delivers the whole request. */
+	rc = jent_read_entropy_timed(ec, data, sizeof(data), (uint64_t)-1);
+	if (rc != (ssize_t)sizeof(data))
+		FAIL("jent_read_entropy_timed: %ld", (long)rc);
+
+	/* Two buffers filled in one call. */
+	iov[0].iov_base = data;
+	iov[0].iov_len = 16;
+	iov[1].iov_base = data + 16;
+	iov[1].iov_len = sizeof(data) - 16;
+	rc = jent_read_entropy_iov(ec, iov, 2);
+	if (rc != (ssize_t)sizeof(data))
+		FAIL("jent_read_entropy_iov: %ld", (long)rc);
+
+	/* The stream hands every byte to the sink. */
+	streamed = 0;
+	rc = jent_read_entropy_stream(ec, 100, stream_sink, &streamed);
+	if (rc != 100 || streamed != 100)
+		FAIL("jent_read_entropy_stream: %ld", (long)rc);
+
+	/* Steps complete a block, which the step read then returns. */
+	do {
+		ret = jent_entropy_step(ec, 64);
+	} while (!ret);
+	if (ret != 1)
+		FAIL("jent_entropy_step: %d", ret);
+	rc = jent_read_entropy_step(ec, data, sizeof(data));
+	if (rc != 32)
+		FAIL("jent_read_entropy_step: %ld", (long)rc);
+
+	/* The default mode may tune its loop counts for latency. */
+	ret = jent_set_latency_target(ec, 1000000);
+	if (ret)
+		FAIL("jent_set_latency_target: %d", ret);
+	rc = jent_read_entropy(ec, data, sizeof(data));
+	if (rc != (ssize_t)sizeof(data))
+		FAIL("jent_read_entropy under a latency target: %ld", (long)rc);
+
+	/* Caller memory: a buffer too small for the collector is refused. */
+	if (jent_entropy_collector_size(0, 0) == 0)
+		FAIL("jent_entropy_collector_size returned 0");
+	if (jent_entropy_collector_init(status, 0, 0, 0))
+		FAIL("jent_entropy_collector_init accepted an empty buffer");
+
+	/* A pool of one hands its collector out and takes it back. */
+	pool = jent_collector_pool_alloc(1, 0, 0);
+	if (!pool)
+		FAIL("jent_collector_pool_alloc returned NULL");
+	pooled = jent_collector_pool_get(pool);
+	if (!pooled)
+		FAIL("jent_collector_pool_get returned NULL");
+	if (jent_collector_pool_count(pool))
+		FAIL("jent_collector_pool_count: the collector is still counted");
+	jent_collector_pool_put(pool, pooled);
+	ret = jent_collector_pool_refill(pool);
+	if (ret)
+		FAIL("jent_collector_pool_refill: %d", ret);
+	jent_collector_pool_free(pool);
+
+	/* A child generator seeded from the collector. */
+	child = jent_drbg_child_alloc(&ec, 0);
+	if (!child)
+		FAIL("jent_drbg_child_alloc returned NULL");
+	rc = jent_drbg_child_generate(child, data, sizeof(data));
+	if (rc != (ssize_t)sizeof(data))
+		FAIL("jent_drbg_child_generate: %ld", (long)rc);
+	jent_drbg_child_free(child);
+
+	/* A deferred collector delivers once its startup completed. */
+	pooled = jent_entropy_collector_alloc_deferred(0, 0);
+	if (!pooled)
+		FAIL("jent_entropy_collector_alloc_deferred returned NULL");
+	while ((ret = jent_entropy_collector_start(&pooled)) ==
+	       JENT_ERR_STARTING)
+		;
+	if (ret)
+		FAIL("jent_entropy_collector_start: %d", ret);
+	rc = jent_read_entropy(pooled, data, sizeof(data));
+	if (rc != (ssize_t)sizeof(data))
+		FAIL("jent_read_entropy after the deferred startup: %ld",
+		     (long)rc);
+	jent_entropy_collector_free(pooled);
+
+	/* Not every host has NUMA placement, only a malformed call fails. */
+	ret = jent_entropy_collector_bind_node(ec, -1);
+	if (ret == -EINVAL)
+		FAIL("jent_entropy_collector_bind_node: %d", ret);
+
 	if (jent_status(ec, status, sizeof(status)))
 		FAIL("jent_status");
 	printf("jent_status:\n%s\n", status);
@@ -14,6 +14,8 @@ raw_entropy_ntg1_hashloop()
 {
 	local hashloop=$1
 	shift
+	local testtype=$1
+	shift
 
 	echo "---"
 	echo "Obtaining $NUM_EVENTS raw entropy measurement from Jitter RNG"
@@ -25,7 +27,7 @@ raw_entropy_ntg1_hashloop()
 		cmdopts="$cmdopts --disable-internal-timer"
 	fi
 
-	$JENT_HASHTIME $NUM_EVENTS 1 $OUTDIR/${NONIID_HASH_DATA}_${hashloop} $cmdopts
+	$JENT_HASHTIME $NUM_EVENTS 1 $OUTDIR/${NONIID_HASH_DATA}_${testtype}${hashloop} $cmdopts
 
 	echo "---"
 }
@@ -38,8 +40,22 @@ make -s -f Makefile.hashtime
 size=0
 while [ $size -le 7 ]
 do
-	raw_entropy_ntg1_hashloop $size --ntg1
+	raw_entropy_ntg1_hashloop $size "" --ntg1
 	size=$((size+1))
 done
 
+# Further hash loop kernels (values of the JENT_HASHKERNEL_* flag field, e.g.
+# HASH_KERNELS="1 2" for the multiply / divide chain and the branch mixer),
+# each recorded at every hash loop count as well
+for kernel in $HASH_KERNELS
+do
+	size=0
+	while [ $size -le 7 ]
+	do
+		raw_entropy_ntg1_hashloop $size "kernel${kernel}_" --ntg1 \
+			--hash-kernel $kernel
+		size=$((size+1))
+	done
+done
+
 make -s -f Makefile.hashtime clean
@@ -67,4 +67,31 @@ do
 	size=$((size+1))
 done
 
+# Further memory access patterns (values of the JENT_MEMACCESS_* flag field,
+# e.g. MEMACCESS_PATTERNS="3 4 5" for the chase, the cache stride and the
+# multistream walk), each recorded at every memory size as well
+for pattern in $MEMACCESS_PATTERNS
+do
+	size=1
+	while [ $size -le 20 ]
+	do
+		raw_entropy_ntg1_memloop $size "pattern${pattern}_" --ntg1 \
+			--mem-pattern $pattern
+		size=$((size+1))
+	done
+done
+
+# With HUGE_PAGES set, the memory sizes of 2 MB (12) and up are recorded once
+# more with the region backed by huge pages (JENT_HUGE_PAGES), to compare the
+# two layouts
+if [ -n "$HUGE_PAGES" ]
+then
+	size=12
+	while [ $size -le 20 ]
+	do
+		raw_entropy_ntg1_memloop $size "hugepages_" --ntg1 --huge-pages
+		size=$((size+1))
+	done
+fi
+
 make -s -f Makefile.hashtime clean
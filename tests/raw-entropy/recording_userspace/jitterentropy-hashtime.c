@@ -100,6 +100,7 @@ enum jent_es {
 	jent_common,		/* Common entropy source */
 	jent_hashloop,		/* SHA3 loop exclusively */
 	jent_memaccess_loop,	/* Memory access loop exclusively */
+	jent_sched_roundtrip,	/* Scheduler round trip exclusively */
 };
 
 /*
@@ -244,7 +245,7 @@ static int jent_one_test(const char *pathname, unsigned long rounds,
 		goto out;
 	}
 #else
-	jent_entropy_init_common_pre(flags);
+	jent_entropy_init_common_pre(flags, 1);
 #endif
 
 	/*
@@ -325,6 +326,10 @@ static int jent_one_test(const char *pathname, unsigned long rounds,
 	printf("Deterministic memory access - Memory size: %" PRIu32 " - Hashloop count: %" PRIu32 "\n",
 	       ec->memmask + 1, ec->hashloopcnt * JENT_HASH_LOOP_INIT);
 #endif
+	if (JENT_FLAGS_TO_MEMACCESS(ec->flags))
+		printf("Memory access pattern: %s\n", jent_memaccess_name(ec));
+	if (JENT_FLAGS_TO_HASHKERNEL(ec->flags))
+		printf("Hash loop kernel: %s\n", jent_hash_kernel_name(ec));
 
 	switch (jent_es) {
 	case jent_hashloop:
@@ -333,6 +338,9 @@ static int jent_one_test(const char *pathname, unsigned long rounds,
 	case jent_memaccess_loop:
 		measure_jitter = jent_measure_jitter_ntg1_memaccess;
 		break;
+	case jent_sched_roundtrip:
+		measure_jitter = jent_measure_jitter_ntg1_sched;
+		break;
 	case jent_common:
 	default:
 		measure_jitter = jent_measure_jitter;
@@ -415,7 +423,15 @@ out:
  *	     loop
  * --hashloop Perform the measurement of the hash loop only
  * --memaccess Perform the measurement of the memory access loop only
+ * --sched Perform the measurement of the scheduling noise source only
+ * --sched-noise Enable flag JENT_SCHED_NOISE
+ * --huge-pages Enable flag JENT_HUGE_PAGES
  * --hloopcnt Number of hashloop operations at runtime
+ * --mem-pattern Memory access pattern: the value of the JENT_MEMACCESS_* flag
+ *		 field, 1 (stride) to 5 (multistream) - recorded alone with
+ *		 --memaccess
+ * --hash-kernel Hash loop kernel: the value of the JENT_HASHKERNEL_* flag field,
+ *		 1 (muldiv) or 2 (branch) - recorded alone with --hashloop
  * --cpu Pin the measurement to the given CPU - use this on hybrid CPUs to
  *	 record one core type at a time (see jitterentropy-cpuinfo). Note that
  *	 the internal timer cannot be used together with this option as its
@@ -442,7 +458,7 @@ int main(int argc, char * argv[])
 	char pathname[4096];
 
 	if (argc < 4) {
-		printf("%s <rounds per repeat> <number of repeats> <filename> [--ntg1|--force-fips|--disable-memory-access|--disable-internal-timer|--force-internal-timer|--osr <OSR>|--loopcnt <NUM>|--max-mem <NUM>|--hashloop|--memaccess|--all-caches|--hloopcnt <NUM>" JENT_USAGE_CPU JENT_USAGE_CORES "|--status]\n", argv[0]);
+		printf("%s <rounds per repeat> <number of repeats> <filename> [--ntg1|--force-fips|--disable-memory-access|--disable-internal-timer|--force-internal-timer|--osr <OSR>|--loopcnt <NUM>|--max-mem <NUM>|--hashloop|--memaccess|--sched|--sched-noise|--huge-pages|--all-caches|--hloopcnt <NUM>|--mem-pattern <NUM>|--hash-kernel <NUM>" JENT_USAGE_CPU JENT_USAGE_CORES "|--status]\n", argv[0]);
 		return 1;
 	}
 
@@ -495,6 +511,12 @@ int main(int argc, char * argv[])
 			jent_es = jent_hashloop;
 		else if (!strncmp(argv[1], "--memaccess", 11))
 			jent_es = jent_memaccess_loop;
+		else if (!strncmp(argv[1], "--sched-noise", 13))
+			flags |= JENT_SCHED_NOISE;
+		else if (!strncmp(argv[1], "--huge-pages", 12))
+			flags |= JENT_HUGE_PAGES;
+		else if (!strncmp(argv[1], "--sched", 7))
+			jent_es = jent_sched_roundtrip;
 		else if (!strncmp(argv[1], "--osr", 5)) {
 			unsigned long val;
 
@@ -642,6 +664,38 @@ int main(int argc, char * argv[])
 				printf("Unknown hashloop value\n");
 				return 1;
 			}
+		} else if (!strncmp(argv[1], "--mem-pattern", 13)) {
+			unsigned long val;
+
+			argc--;
+			argv++;
+			if (argc <= 1) {
+				printf("Memory access pattern value missing\n");
+				return 1;
+			}
+
+			if (parse_ulong(argv[1], &val) ||
+			    val > JENT_FLAGS_TO_MEMACCESS(JENT_MEMACCESS_MAX)) {
+				printf("Unknown memory access pattern value\n");
+				return 1;
+			}
+			flags |= JENT_MEMACCESS_TO_FLAGS((unsigned int)val);
+		} else if (!strncmp(argv[1], "--hash-kernel", 13)) {
+			unsigned long val;
+
+			argc--;
+			argv++;
+			if (argc <= 1) {
+				printf("Hash loop kernel value missing\n");
+				return 1;
+			}
+
+			if (parse_ulong(argv[1], &val) ||
+			    val > JENT_FLAGS_TO_HASHKERNEL(JENT_HASHKERNEL_MAX)) {
+				printf("Unknown hash loop kernel value\n");
+				return 1;
+			}
+			flags |= JENT_HASHKERNEL_TO_FLAGS((unsigned int)val);
 		} else if (!strncmp(argv[1], "--cpu", 5)) {
 			unsigned long val;
 
@@ -25,6 +25,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
 # include <fcntl.h>
@@ -49,6 +50,17 @@ static int parse_ulong(const char *str, unsigned long *val)
 	return 0;
 }
 
+/* Wall clock in microseconds for --timing; timespec_get() is plain C11 */
+static unsigned long long now_us(void)
+{
+	struct timespec ts;
+
+	if (!timespec_get(&ts, TIME_UTC))
+		return 0;
+	return (unsigned long long)ts.tv_sec * 1000000ULL +
+	       (unsigned long long)ts.tv_nsec / 1000ULL;
+}
+
 int main(int argc, char * argv[])
 {
 	unsigned long long size, rounds;
@@ -56,11 +68,12 @@ int main(int argc, char * argv[])
 	unsigned int flags = 0, osr = 0;
 	struct rand_data *ec_nostir;
 	char status[4096];
-	int hex = 0;
+	unsigned long long start = 0, loop_start = 0;
+	int hex = 0, timing = 0;
 	size_t i;
 
 	if (argc < 2) {
-		printf("%s <number of measurements> [--ntg1|--force-fips|--disable-memory-access|--disable-internal-timer|--force-internal-timer|--all-caches|--osr <OSR>|--max-mem <NUM>|--hloopcnt <NUM>|--hex]\n", argv[0]);
+		printf("%s <number of measurements> [--ntg1|--force-fips|--disable-memory-access|--disable-internal-timer|--force-internal-timer|--all-caches|--huge-pages|--osr <OSR>|--max-mem <NUM>|--hloopcnt <NUM>|--hex|--timing]\n", argv[0]);
 		return 1;
 	}
 
@@ -90,6 +103,8 @@ int main(int argc, char * argv[])
 			flags |= JENT_FORCE_INTERNAL_TIMER;
 		else if (!strncmp(argv[1], "--all-caches", 12))
 			flags |= JENT_CACHE_ALL;
+		else if (!strncmp(argv[1], "--huge-pages", 12))
+			flags |= JENT_HUGE_PAGES;
 		else if (!strncmp(argv[1], "--osr", 5)) {
 			unsigned long val;
 
@@ -226,6 +241,8 @@ int main(int argc, char * argv[])
 			}
 		} else if (!strncmp(argv[1], "--hex", 5)) {
 			hex = 1;
+		} else if (!strncmp(argv[1], "--timing", 8)) {
+			timing = 1;
 		} else {
 			printf("Unknown option %s\n", argv[1]);
 			return 1;
@@ -263,11 +280,19 @@ int main(int argc, char * argv[])
 		return ret;
 	}
 
+	/*
+	 * --timing reports the latency of the allocation, which includes the
+	 * startup rounds of the noise source, and of the first read. Both
+	 * grow with the memory size the moment page faults are involved.
+	 */
+	start = now_us();
 	ec_nostir = jent_entropy_collector_alloc(osr, flags);
 	if (!ec_nostir) {
 		printf("Jitter RNG handle cannot be allocated\n");
 		return 1;
 	}
+	if (timing)
+		fprintf(stderr, "Allocation: %llu us\n", now_us() - start);
 
 	if (jent_status(ec_nostir, status, sizeof(status))) {
 		printf("Cannot obtain status information\n");
@@ -295,11 +320,18 @@ int main(int argc, char * argv[])
 	for (size = 0; size < rounds; size++) {
 		uint8_t tmp[32];
 
+		if (!size)
+			start = now_us();
+		else if (size == 1)
+			loop_start = now_us();
 		if (0 > jent_read_entropy_safe(&ec_nostir, (char*)tmp, sizeof(tmp))) {
 			fprintf(stderr, "FIPS 140-3 health test failed\n");
 			ret = 1;
 			goto out;
 		}
+		if (!size && timing)
+			fprintf(stderr, "First read: %llu us\n",
+				now_us() - start);
 		/*
 		 * Treat output errors as fatal: consumers pipe this data into
 		 * files for analysis, and a silently truncated stream with
@@ -335,6 +367,18 @@ int main(int argc, char * argv[])
 		goto out;
 	}
 
+	/*
+	 * And the rate of the reads after the first: output blocks per second,
+	 * each a fixed number of time deltas for the oversampling rate the
+	 * status reports.
+	 */
+	if (timing && rounds > 1) {
+		unsigned long long elapsed = now_us() - loop_start;
+
+		fprintf(stderr, "Throughput: %llu blocks/s\n",
+			elapsed ? (rounds - 1) * 1000000ULL / elapsed : 0);
+	}
+
 	ret = 0;
 
 out:
@@ -73,6 +73,8 @@
 #if !defined(LIBGCRYPT) && !defined(AWSLC) && !defined(OPENSSL)
 # if defined(JENT_ARCH_MEM_POSIX_MLOCK)
 #  define JENT_UT_GUARD_POSIX
+#  include <pthread.h>
+#  include <signal.h>
 #  include <sys/resource.h>
 #  include <sys/wait.h>
 #  include <unistd.h>
@@ -305,10 +307,333 @@ static void test_memory(void)
 	}
 }
 
+/*
+ * The NUMA helpers. A host without NUMA support in its kernel, or a sandbox
+ * refusing the system calls, still has to answer consistently: no local node
+ * means no binding either.
+ */
+static void test_numa(void)
+{
+	size_t len = 64 * 1024;
+	unsigned char *p;
+	int node, ret;
+
+	jent_ut_group("NUMA placement");
+
+	JENT_UT_EQ(jent_memory_bind_node(NULL, len, 0), -EINVAL,
+		   "a NULL allocation is rejected");
+	JENT_UT_EQ(jent_memory_node(NULL), -1, "a NULL allocation has no node");
+
+	node = jent_memory_local_node();
+	if (node < 0) {
+		JENT_UT_EQ(jent_memory_bind_node(&node, sizeof(node), 0),
+			   -EOPNOTSUPP, "without a local node nothing binds");
+		return;
+	}
+
+	p = jent_zalloc(len, 0);
+	if (!p) {
+		JENT_UT_SKIP("NUMA placement", "allocation failed");
+		return;
+	}
+
+	JENT_UT_EQ(jent_memory_bind_node(p, len, -1), -EINVAL,
+		   "a negative node is rejected");
+
+	ret = jent_memory_bind_node(p, len, node);
+	if (ret == -EOPNOTSUPP || ret == -EPERM) {
+		JENT_UT_SKIP("NUMA placement", "mbind is not permitted here");
+	} else {
+		JENT_UT_EQ(ret, 0, "the allocation binds to the local node");
+		p[0] = 1;
+		JENT_UT_EQ(jent_memory_node(p + len / 2), node,
+			   "and is found there");
+	}
+
+	jent_zfree(p, len);
+
+#if defined(JENT_ARCH_MEM_NUMA) && defined(JENT_UT_GUARD_POSIX)
+	/* An object smaller than a page is bound with the page it owns */
+	p = jent_zalloc(100, 0);
+	if (p && !ret) {
+		int mode = -1;
+
+		JENT_UT_EQ(jent_memory_bind_alloc(p, 100, node), 0,
+			   "a small object binds");
+		JENT_UT_TRUE(!syscall(SYS_get_mempolicy, &mode, NULL, 0, p,
+				      JENT_MPOL_F_ADDR) &&
+			     mode == JENT_MPOL_BIND,
+			     "and its page carries the binding");
+	}
+	jent_zfree(p, 100);
+#endif
+}
+
+/*
+ * JENT_HUGE_PAGES: whatever backing the system grants, the allocation is
+ * zeroed, usable to its end and freed by the plain jent_zfree(). The POSIX
+ * backend also aligns it to a huge page.
+ */
+static void test_huge_pages(void)
+{
+	static const size_t lens[] = { 2 * 1024 * 1024, 4 * 1024 * 1024,
+				       3 * 1024 * 1024 + 1 };
+	unsigned int i;
+
+	jent_ut_group("JENT_HUGE_PAGES");
+
+	for (i = 0; i < JENT_ARRAY_SIZE(lens); i++) {
+		size_t len = lens[i], j, nonzero = 0;
+		unsigned char *p = jent_zalloc(len, JENT_HUGE_PAGES);
+
+		if (!p) {
+			JENT_UT_SKIP("JENT_HUGE_PAGES", "allocation failed");
+			continue;
+		}
+
+		for (j = 0; j < len; j += 4096)
+			nonzero += p[j] != 0;
+		JENT_UT_EQ(nonzero + (p[len - 1] != 0), 0,
+			   "the allocation is zeroed");
+#ifdef JENT_UT_GUARD_POSIX
+		JENT_UT_EQ((uintptr_t)p & (JENT_HUGE_PAGE_SIZE - 1), 0,
+			   "and starts on a huge page");
+#endif
+		memset(p, 0xa5, len);
+		jent_zfree(p, len);
+	}
+}
+
+/*
+ * jent_free_nonsensitive() releases without wiping; what comes back from the
+ * next allocation is zeroed all the same.
+ */
+static void test_free_nonsensitive(void)
+{
+	static const size_t lens[] = { 64, 1 << 20 };
+	unsigned int i;
+
+	jent_ut_group("jent_free_nonsensitive");
+
+	jent_free_nonsensitive(NULL, 4096);
+	JENT_UT_TRUE(1, "a NULL pointer is a no-op");
+
+	for (i = 0; i < JENT_ARRAY_SIZE(lens); i++) {
+		size_t len = lens[i], j, nonzero = 0;
+		unsigned char *p = jent_zalloc(len, 0);
+
+		if (!p) {
+			JENT_UT_SKIP("jent_free_nonsensitive",
+				     "allocation failed");
+			continue;
+		}
+		memset(p, 0xa5, len);
+		jent_free_nonsensitive(p, len);
+
+		p = jent_zalloc(len, 0);
+		if (!p) {
+			JENT_UT_FAIL("%s", "no second allocation");
+			continue;
+		}
+		for (j = 0; j < len; j++)
+			nonzero += p[j] != 0;
+		JENT_UT_EQ(nonzero, 0, "the next allocation is zeroed");
+		jent_free_nonsensitive(p, len);
+	}
+}
+
+#ifdef JENT_UT_GUARD_POSIX
+/*
+ * The slab of small objects: only for secure memory, cache line aligned,
+ * disjoint, zeroed on the way out and back in, and the slab goes away with
+ * its last object. A slab that could not be locked is not tried again.
+ */
+static void test_slab(void)
+{
+	unsigned char *a, *b, *c;
+	size_t i, nonzero = 0;
+
+	jent_ut_group("the slab of small objects");
+
+	a = jent_zalloc(100, 0);
+	JENT_UT_TRUE(a && (uintptr_t)a % jent_pagesize() == 0 && !jent_slabs,
+		     "an object not demanding secure memory is mapped alone");
+	jent_zfree(a, 100);
+
+	if (jent_memory_nodes() > 1) {
+		JENT_UT_SKIP("the slab", "no slab on a host with NUMA nodes");
+		return;
+	}
+
+	a = jent_zalloc(100, JENT_FORCE_SECURE_MEM);
+	b = jent_zalloc(JENT_SLAB_MAX_OBJECT, JENT_FORCE_SECURE_MEM);
+	if (!a || !b) {
+		JENT_UT_SKIP("the slab", "no locked memory for a slab");
+		jent_zfree(a, 100);
+		jent_zfree(b, JENT_SLAB_MAX_OBJECT);
+		return;
+	}
+
+	JENT_UT_EQ((uintptr_t)a % JENT_SLAB_UNIT, 0, "objects are cache line aligned");
+	JENT_UT_EQ((uintptr_t)b % JENT_SLAB_UNIT, 0, "whatever their size");
+	JENT_UT_TRUE(a + JENT_SLAB_UNIT * 2 <= b || b + JENT_SLAB_MAX_OBJECT <= a,
+		     "and do not overlap");
+	JENT_UT_TRUE(jent_slabs && jent_slab_free(a, 100) == 1,
+		     "a small object is released to its slab");
+
+	/* b keeps the slab mapped, so the units of a can be inspected */
+	for (i = 0; i < 2 * JENT_SLAB_UNIT; i++)
+		nonzero += a[i] != 0;
+	JENT_UT_EQ(nonzero, 0, "its units are wiped");
+
+	memset(b, 0xa5, JENT_SLAB_MAX_OBJECT);
+	c = jent_zalloc(100, JENT_FORCE_SECURE_MEM);
+	JENT_UT_TRUE(c != NULL && !c[0] && !c[99], "a new object is zeroed");
+	jent_zfree(c, 100);
+
+	jent_zfree(b, JENT_SLAB_MAX_OBJECT);
+	JENT_UT_TRUE(jent_slabs == NULL, "the empty slab is unmapped");
+
+	/* Just above the limit, the object is mapped on its own */
+	a = jent_zalloc(JENT_SLAB_MAX_OBJECT + 1, JENT_FORCE_SECURE_MEM);
+	JENT_UT_TRUE(a && (uintptr_t)a % jent_pagesize() == 0 && !jent_slabs,
+		     "a larger object is a mapping of its own");
+	jent_zfree(a, JENT_SLAB_MAX_OBJECT + 1);
+
+	/* As after a refused slab: objects go straight to a mapping */
+	jent_atomic_store_int(&jent_slab_refused, 1);
+	a = jent_zalloc(100, JENT_FORCE_SECURE_MEM);
+	JENT_UT_TRUE(a && (uintptr_t)a % jent_pagesize() == 0 && !jent_slabs,
+		     "a refused slab is not tried again");
+	jent_zfree(a, 100);
+	jent_atomic_store_int(&jent_slab_refused, 0);
+}
+
+/*
+ * The fork generation stays put within a process and moves in the child of a
+ * fork(), without moving in the parent.
+ */
+static void test_fork_generation(void)
+{
+	uint32_t generation;
+	pid_t pid;
+	int status;
+
+	jent_ut_group("jent_fork_generation");
+
+	generation = jent_fork_generation();
+	JENT_UT_EQ(jent_fork_generation(), generation,
+		   "the generation is stable within a process");
+
+	pid = fork();
+	if (pid < 0) {
+		JENT_UT_SKIP("jent_fork_generation", "fork() failed");
+		return;
+	}
+	if (!pid)
+		_exit(jent_fork_generation() != generation ? 0 : 1);
+
+	JENT_UT_TRUE(waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+		     WEXITSTATUS(status) == 0,
+		     "it differs in the child");
+	JENT_UT_EQ(jent_fork_generation(), generation,
+		   "and stays in the parent");
+}
+
+/* Holds a spin lock for a while once the main thread may fork */
+struct jent_ut_holder {
+	int *lock;
+	int held;
+};
+
+static void *jent_ut_hold_lock(void *arg)
+{
+	struct jent_ut_holder *holder = arg;
+
+	while (jent_atomic_exchange_int(holder->lock, 1))
+		;
+	jent_atomic_store_int(&holder->held, 1);
+	usleep(100000);
+	jent_atomic_store_int(holder->lock, 0);
+
+	return NULL;
+}
+
+/*
+ * Fork while another thread holds @lock: the child has to find it free. A
+ * child that spins on it is killed after two seconds.
+ */
+static int jent_ut_fork_free(int *lock)
+{
+	struct jent_ut_holder holder = { lock, 0 };
+	pthread_t thread;
+	pid_t pid;
+	int status, i;
+
+	if (pthread_create(&thread, NULL, jent_ut_hold_lock, &holder))
+		return -1;
+	while (!jent_atomic_load_int(&holder.held))
+		;
+
+	pid = fork();
+	if (!pid) {
+		while (jent_atomic_exchange_int(lock, 1))
+			;
+		_exit(0);
+	}
+	pthread_join(thread, NULL);
+	if (pid < 0)
+		return -1;
+
+	for (i = 0; i < 200; i++) {
+		if (waitpid(pid, &status, WNOHANG) == pid)
+			return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		usleep(10000);
+	}
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+
+	return 0;
+}
+
+/*
+ * A fork() cannot copy the spin locks of the library while they are held:
+ * the slab list and whatever jent_fork_guard() names.
+ */
+static void test_fork_locks(void)
+{
+	static int lock;
+	int ret;
+
+	jent_ut_group("spin locks across fork()");
+
+	jent_fork_generation();
+	ret = jent_ut_fork_free(&jent_slabs_locked);
+	if (ret < 0) {
+		JENT_UT_SKIP("spin locks across fork()", "no thread or child");
+		return;
+	}
+	JENT_UT_EQ(ret, 1, "the child finds the slab list unlocked");
+
+	jent_fork_guard(&lock);
+	jent_fork_guard(&lock);
+	JENT_UT_EQ(jent_ut_fork_free(&lock), 1,
+		   "and a guarded lock as well");
+}
+#endif
+
 int main(void)
 {
 	test_memory();
 	test_guard_pages();
+	test_numa();
+	test_huge_pages();
+	test_free_nonsensitive();
+#ifdef JENT_UT_GUARD_POSIX
+	test_slab();
+	test_fork_generation();
+	test_fork_locks();
+#endif
 
 	return jent_ut_report("unit-arch-memory");
 }
@@ -36,6 +36,8 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 /*
  * The atomic accessors of the process-wide state. Absorbed ahead of
@@ -52,6 +54,9 @@
 #include "jitterentropy-base.c"
 #include "jitterentropy-uuid.c"
 #include "jitterentropy-status.c"
+#include "jitterentropy-autotune.c"
+#include "jitterentropy-pool.c"
+#include "jitterentropy-drbg-child.c"
 
 #include "jitterentropy-arch-cache.c"
 #include "jitterentropy-arch-fips.c"
@@ -130,6 +135,9 @@ static void test_collector_alloc(void)
 	JENT_UT_EQ(ec->osr, JENT_MIN_OSR, "osr 0 was raised to the minimum");
 	JENT_UT_EQ((uint32_t)ec->memmask + 1, 1048576u,
 		   "the requested memory size was honoured");
+	JENT_UT_TRUE((unsigned char *)ec->hash_state ==
+		     (unsigned char *)ec + JENT_COLLECTOR_HASH_OFFSET,
+		     "the hash state is allocated right behind the state");
 	jent_entropy_collector_free(ec);
 
 	/*
@@ -556,6 +564,881 @@ static void test_secure_memory_supported(void)
 	       ret ? "provided" : "not provided");
 }
 
+/*
+ * Whether the host can bind is not asserted, only that an unbindable host
+ * says so and leaves the collector working and unbound.
+ */
+static void test_bind_node(void)
+{
+	struct rand_data *ec;
+	char buf[32];
+	int ret;
+
+	jent_ut_group("jent_entropy_collector_bind_node");
+
+	JENT_UT_EQ(jent_entropy_collector_bind_node(NULL, -1), -EINVAL,
+		   "a NULL collector is rejected");
+
+	ec = jent_entropy_collector_alloc(0, 0);
+	if (!ec) {
+		JENT_UT_SKIP("jent_entropy_collector_bind_node",
+			     "no collector could be allocated");
+		return;
+	}
+
+	JENT_UT_EQ(jent_entropy_collector_bind_node(ec, -2), -EINVAL,
+		   "a node below -1 is rejected");
+	JENT_UT_EQ(ec->numa_node, -1, "a new collector is unbound");
+
+	ret = jent_entropy_collector_bind_node(ec, -1);
+	if (ret) {
+		printf("  note: NUMA binding unavailable: %d\n", ret);
+		JENT_UT_EQ(ec->numa_node, -1, "a failed binding leaves it unbound");
+	} else {
+		JENT_UT_EQ(ec->numa_node, jent_memory_local_node(),
+			   "the collector is bound to the local node");
+		JENT_UT_EQ(jent_memory_node(ec->hash_state), ec->numa_node,
+			   "and so is its hash state");
+		JENT_UT_TRUE(!ec->mem ||
+			     jent_memory_node(ec->mem) == ec->numa_node,
+			     "and its memory access region");
+	}
+
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)), (ssize_t)sizeof(buf),
+		   "the collector still generates");
+
+	jent_entropy_collector_free(ec);
+}
+
+static void test_collector_init(void)
+{
+	struct rand_data *ec;
+	unsigned char *mem;
+	char buf[32], status[8192];
+	size_t size, i;
+
+	jent_ut_group("jent_entropy_collector_init");
+
+	JENT_UT_EQ(jent_entropy_collector_size(JENT_MAX_OSR + 1, 0), (size_t)0,
+		   "an osr above JENT_MAX_OSR has no size");
+	size = jent_entropy_collector_size(0, JENT_MAX_MEMSIZE_64kB);
+	JENT_UT_EQ(size, JENT_COLLECTOR_MEM_OFFSET + (size_t)(64 << 10),
+		   "the size covers the state, hash state and memory region");
+	JENT_UT_EQ(jent_entropy_collector_size(0, JENT_DISABLE_MEMORY_ACCESS),
+		   (size_t)JENT_COLLECTOR_MEM_OFFSET,
+		   "without memory access there is no memory region");
+
+	if (posix_memalign((void **)&mem, JENT_COLLECTOR_ALIGN, size + 1)) {
+		JENT_UT_FAIL("%s", "no test memory");
+		return;
+	}
+
+	JENT_UT_TRUE(!jent_entropy_collector_init(NULL, size, 0,
+						  JENT_MAX_MEMSIZE_64kB),
+		     "a NULL buffer is rejected");
+	JENT_UT_TRUE(!jent_entropy_collector_init(mem + 1, size, 0,
+						  JENT_MAX_MEMSIZE_64kB),
+		     "a misaligned buffer is rejected");
+	JENT_UT_TRUE(!jent_entropy_collector_init(mem, size - 1, 0,
+						  JENT_MAX_MEMSIZE_64kB),
+		     "a buffer too short by a byte is rejected");
+	JENT_UT_TRUE(!jent_entropy_collector_init(mem, size, 0,
+						  JENT_MAX_MEMSIZE_64kB |
+						  JENT_FORCE_SECURE_MEM),
+		     "secure memory the library cannot lock is rejected");
+
+	ec = jent_entropy_collector_init(mem, size, 0, JENT_MAX_MEMSIZE_64kB);
+	if (!ec) {
+		JENT_UT_SKIP("jent_entropy_collector_init",
+			     "no collector without the internal timer");
+		free(mem);
+		return;
+	}
+
+	JENT_UT_TRUE((void *)ec == (void *)mem, "the collector lives in the buffer");
+	JENT_UT_TRUE(ec->hash_state == mem + JENT_COLLECTOR_HASH_OFFSET &&
+		     ec->mem == mem + JENT_COLLECTOR_MEM_OFFSET,
+		     "and so do its hash state and memory region");
+	JENT_UT_TRUE(!ec->enable_notime, "it runs without the internal timer");
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)), (ssize_t)sizeof(buf),
+		   "the collector generates");
+	JENT_UT_EQ(jent_read_entropy_safe(&ec, buf, sizeof(buf)),
+		   (ssize_t)sizeof(buf), "also through the safe variant");
+
+	JENT_UT_EQ(jent_status(ec, status, sizeof(status)), 0, "jent_status");
+	JENT_UT_TRUE(strstr(status, "\"callerMemory\": true") != NULL,
+		     "reporting caller memory");
+	JENT_UT_TRUE(strstr(status, "\"secureMemory\": false") != NULL,
+		     "that is not secure memory");
+
+	jent_entropy_collector_free(ec);
+	for (i = 0; i < size && !mem[i]; i++)
+		;
+	JENT_UT_EQ(i, size, "freeing wipes the buffer");
+
+	free(mem);
+}
+
+static void test_shared_memory(void)
+{
+	const unsigned int flags = JENT_SHARED_MEMORY | JENT_MAX_MEMSIZE_64kB;
+	struct rand_data *a, *b, *own, *other;
+	char buf[32];
+
+	jent_ut_group("JENT_SHARED_MEMORY");
+
+	a = jent_entropy_collector_alloc(0, flags);
+	b = jent_entropy_collector_alloc(0, flags);
+	own = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_64kB);
+	other = jent_entropy_collector_alloc(0, JENT_SHARED_MEMORY |
+						JENT_MAX_MEMSIZE_8kB);
+	if (!a || !b || !own || !other) {
+		JENT_UT_SKIP("JENT_SHARED_MEMORY",
+			     "no collector could be allocated");
+		goto out;
+	}
+
+	JENT_UT_TRUE(a->mem && a->mem == b->mem,
+		     "collectors of the same size share their region");
+	JENT_UT_TRUE(a->memlocation != b->memlocation,
+		     "each walking it from an offset of its own");
+	JENT_UT_EQ(a->shared_mem->users, 2U, "the region counts its users");
+	JENT_UT_TRUE(own->mem != a->mem && !own->shared_mem,
+		     "a collector without the flag has a region of its own");
+	JENT_UT_TRUE(other->mem != a->mem,
+		     "as does one of another memory size");
+
+	jent_entropy_collector_free(a);
+	a = NULL;
+	JENT_UT_EQ(b->shared_mem->users, 1U,
+		   "freeing a collector detaches it from the region");
+	JENT_UT_EQ(jent_read_entropy(b, buf, sizeof(buf)), (ssize_t)sizeof(buf),
+		   "which the other collector still generates from");
+
+out:
+	jent_entropy_collector_free(a);
+	jent_entropy_collector_free(b);
+	jent_entropy_collector_free(own);
+	jent_entropy_collector_free(other);
+	JENT_UT_TRUE(jent_shared_mems == NULL,
+		     "the last collector frees the region");
+}
+
+/*
+ * The pool hands out each collector once, takes back what it has room for
+ * and what is still healthy and of its configuration, without the block the
+ * last caller began, and is refilled to its size.
+ */
+static void test_collector_pool(void)
+{
+	const unsigned int flags = JENT_MAX_MEMSIZE_8kB;
+	struct jent_collector_pool *pool;
+	struct rand_data *ec[4], *other;
+	unsigned int i;
+
+	jent_ut_group("the collector pool");
+
+	JENT_UT_TRUE(!jent_collector_pool_alloc(0, 0, flags),
+		     "an empty pool is refused");
+	JENT_UT_TRUE(!jent_collector_pool_alloc(JENT_COLLECTOR_POOL_MAX + 1, 0,
+						flags),
+		     "as is one above JENT_COLLECTOR_POOL_MAX");
+
+	pool = jent_collector_pool_alloc(3, 0, flags);
+	if (!pool) {
+		JENT_UT_SKIP("the collector pool",
+			     "no collector could be allocated");
+		return;
+	}
+	JENT_UT_EQ(jent_collector_pool_count(pool), 3U,
+		   "a new pool is full");
+
+	for (i = 0; i < 4; i++)
+		ec[i] = jent_collector_pool_get(pool);
+	JENT_UT_TRUE(ec[0] && ec[1] && ec[2] && ec[3],
+		     "an empty pool still hands out a collector");
+	JENT_UT_TRUE(ec[0] != ec[1] && ec[0] != ec[2] && ec[0] != ec[3] &&
+		     ec[1] != ec[2] && ec[1] != ec[3] && ec[2] != ec[3],
+		     "each one once");
+	JENT_UT_TRUE(ec[3] && ec[3]->startup_state == jent_startup_completed,
+		     "that one completed its startup as well");
+	JENT_UT_EQ(jent_collector_pool_count(pool), 0U, "the pool is empty");
+
+	jent_collector_pool_put(pool, ec[0]);
+	jent_collector_pool_put(pool, ec[0]);
+	JENT_UT_EQ(jent_collector_pool_count(pool), 1U,
+		   "a collector returned twice is held once");
+	JENT_UT_TRUE(jent_collector_pool_get(pool) == ec[0],
+		   "and handed out again");
+
+	ec[1]->health_failure = 1;
+	jent_collector_pool_put(pool, ec[1]);
+	JENT_UT_EQ(jent_collector_pool_count(pool), 0U,
+		   "a collector that failed its health tests is freed");
+
+	other = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_16kB);
+	jent_collector_pool_put(pool, other);
+	JENT_UT_EQ(jent_collector_pool_count(pool), 0U,
+		   "as is one of another configuration");
+	other = jent_collector_pool_get(pool);
+	if (other)
+		other->osr++;
+	jent_collector_pool_put(pool, other);
+	JENT_UT_EQ(jent_collector_pool_count(pool), 0U,
+		   "and one whose OSR a recovery raised");
+
+	ec[2]->block_ready = 1;
+	ec[2]->block_samples = 5;
+	ec[2]->block_interrupted = 1;
+	ec[2]->latency_target = 1;
+	ec[2]->memaccessloops = 0;
+	jent_collector_pool_put(pool, ec[2]);
+	JENT_UT_TRUE(jent_collector_pool_get(pool) == ec[2],
+		     "a returned collector is handed out again");
+	JENT_UT_TRUE(!ec[2]->block_ready && !ec[2]->block_samples &&
+		     !ec[2]->block_interrupted,
+		     "without the block of its last caller");
+	JENT_UT_TRUE(!ec[2]->latency_target &&
+		     ec[2]->memaccessloops == ec[2]->latency_mem_loops_max,
+		     "and with its loop counts restored");
+
+	jent_collector_pool_put(pool, ec[0]);
+	jent_collector_pool_put(pool, ec[2]);
+	jent_collector_pool_put(pool, ec[3]);
+	JENT_UT_EQ(jent_collector_pool_count(pool), 3U,
+		   "returned collectors fill the pool");
+
+	ec[0] = jent_collector_pool_get(pool);
+	jent_collector_pool_put(NULL, ec[0]);
+	JENT_UT_EQ(jent_collector_pool_refill(pool), 0,
+		   "jent_collector_pool_refill");
+	JENT_UT_EQ(jent_collector_pool_count(pool), 3U,
+		   "which fills it up again");
+	JENT_UT_EQ(jent_collector_pool_refill(NULL), -EINVAL,
+		   "a NULL pool is refused");
+
+	jent_collector_pool_free(pool);
+}
+
+/*
+ * jent_read_entropy_timed() delivers whole blocks within its budget and keeps
+ * the samples of the block the budget ends in: read with no budget at all, a
+ * block still completes, one sample per call.
+ */
+static void test_read_entropy_timed(void)
+{
+	struct rand_data *ec;
+	char buf[2 * 32 + 5];
+	unsigned int calls = 0, nosr, samples, lost = 0;
+	ssize_t ret;
+
+	jent_ut_group("jent_read_entropy_timed");
+
+	JENT_UT_EQ(jent_read_entropy_timed(NULL, buf, sizeof(buf), 1000),
+		   (ssize_t)JENT_ERR_EINVAL, "a NULL collector is refused");
+
+	ec = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_8kB);
+	if (!ec) {
+		JENT_UT_SKIP("jent_read_entropy_timed",
+			     "no collector could be allocated");
+		return;
+	}
+	JENT_UT_EQ(jent_read_entropy_timed(ec, NULL, 1, 1000),
+		   (ssize_t)JENT_ERR_EINVAL, "as is a NULL buffer");
+
+	JENT_UT_EQ(jent_read_entropy_timed(ec, buf, sizeof(buf), (uint64_t)-1),
+		   (ssize_t)sizeof(buf), "a budget that lasts delivers it all");
+	JENT_UT_EQ(ec->read_deadline, 0, "and leaves no deadline behind");
+
+	ret = jent_read_entropy_timed(ec, buf, 32, 0);
+	JENT_UT_EQ(ret, 0, "no budget delivers nothing");
+	JENT_UT_TRUE(ec->block_interrupted, "but keeps the block it sampled");
+
+	/* A stuck sample is not counted, so calls may collect nothing */
+	nosr = ec->rct_mem_nosr;
+	do {
+		samples = ec->block_samples;
+		ret = jent_read_entropy_timed(ec, buf, 32, 0);
+		if (!ret && ec->block_samples < samples)
+			lost++;
+		calls++;
+	} while (!ret && calls <= 4 * nosr);
+	printf("  note: %u calls, %u samples per block\n", calls, nosr);
+	JENT_UT_EQ(ret, 32, "the block completes over the calls");
+	JENT_UT_EQ(lost, 0U, "without starting over");
+	JENT_UT_EQ(ec->block_samples, 0, "and a new one begins");
+
+	ret = jent_read_entropy_timed(ec, buf, 32, 0);
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+		   (ssize_t)sizeof(buf),
+		   "jent_read_entropy continues an interrupted block");
+
+	jent_entropy_collector_free(ec);
+
+	/*
+	 * The startup of the compliance modes takes a block of each noise
+	 * source in turn. One the end of a step interrupts is continued, not
+	 * left for the next source.
+	 */
+	ec = jent_entropy_collector_alloc_deferred(0, JENT_FORCE_FIPS |
+						      JENT_MAX_MEMSIZE_8kB);
+	if (!ec || ec->startup_state == jent_startup_completed) {
+		JENT_UT_SKIP("an interrupted startup block",
+			     "no collector in its startup");
+	} else {
+		int state = ec->startup_state;
+
+		ec->step_samples = 1;
+		jent_random_data(ec);
+		ec->step_samples = 0;
+		JENT_UT_TRUE(ec->block_interrupted && ec->block_samples,
+			     "a startup block is interrupted as well");
+		JENT_UT_EQ(ec->startup_state, state,
+			   "and continued with the same noise source");
+	}
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * jent_entropy_step() completes a block over calls of a few samples each,
+ * which jent_read_entropy_step() - or jent_read_entropy() - then returns.
+ */
+static void test_entropy_step(void)
+{
+	struct rand_data *ec;
+	char buf[40];
+	unsigned int steps = 0, samples;
+	int ret;
+
+	jent_ut_group("jent_entropy_step");
+
+	JENT_UT_EQ(jent_entropy_step(NULL, 1), JENT_ERR_EINVAL,
+		   "a NULL collector is refused");
+	JENT_UT_EQ(jent_read_entropy_step(NULL, buf, 32),
+		   (ssize_t)JENT_ERR_EINVAL, "by the read as well");
+
+	ec = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_8kB);
+	if (!ec) {
+		JENT_UT_SKIP("jent_entropy_step",
+			     "no collector could be allocated");
+		return;
+	}
+	JENT_UT_EQ(jent_entropy_step(ec, 0), JENT_ERR_EINVAL,
+		   "as is a step of no samples");
+	JENT_UT_EQ(jent_read_entropy_step(ec, buf, sizeof(buf)), 0,
+		   "nothing is read before a block completed");
+
+	ret = jent_entropy_step(ec, 1);
+	JENT_UT_EQ(ret, 0, "one sample does not complete a block");
+	JENT_UT_TRUE(ec->block_interrupted, "which is kept");
+	JENT_UT_TRUE(ec->block_samples <= 1, "one sample besides the priming");
+
+	samples = ec->block_samples;
+	JENT_UT_EQ(jent_entropy_step(ec, 4), 0, "a step of four");
+	JENT_UT_TRUE(ec->block_samples - samples <= 3,
+		     "counts the priming measurement among them");
+
+	do {
+		ret = jent_entropy_step(ec, 16);
+		steps++;
+	} while (!ret && steps <= 4 * ec->rct_mem_nosr);
+	printf("  note: %u steps of 16 samples\n", steps);
+	JENT_UT_EQ(ret, 1, "the block completes over the steps");
+	JENT_UT_TRUE(steps > 1, "not in a single one");
+	JENT_UT_EQ(jent_entropy_step(ec, 1), 1, "and waits to be read");
+
+	JENT_UT_EQ(jent_read_entropy_step(ec, buf, sizeof(buf)), (ssize_t)32,
+		   "the read returns one block");
+	JENT_UT_EQ(jent_read_entropy_step(ec, buf, sizeof(buf)), 0,
+		   "once");
+
+	while (!(ret = jent_entropy_step(ec, 64)))
+		;
+	JENT_UT_EQ(ret, 1, "a completed block");
+	JENT_UT_EQ(jent_read_entropy(ec, buf, 32), (ssize_t)32,
+		   "is used by jent_read_entropy");
+	JENT_UT_TRUE(!ec->block_ready, "which consumes it");
+
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * jent_read_entropy_iov() fills every buffer, each with blocks of its own, and
+ * counts the request as one read.
+ */
+static void test_read_entropy_iov(void)
+{
+	struct rand_data *ec;
+	struct jent_iovec iov[4];
+	char a[16], b[40], c[16];
+	uint64_t invocations, bytes;
+
+	jent_ut_group("jent_read_entropy_iov");
+
+	JENT_UT_EQ(jent_read_entropy_iov(NULL, iov, 1),
+		   (ssize_t)JENT_ERR_EINVAL, "a NULL collector is refused");
+
+	ec = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_8kB);
+	if (!ec) {
+		JENT_UT_SKIP("jent_read_entropy_iov",
+			     "no collector could be allocated");
+		return;
+	}
+	JENT_UT_EQ(jent_read_entropy_iov(ec, NULL, 1),
+		   (ssize_t)JENT_ERR_EINVAL, "as is a NULL vector");
+
+	iov[0].iov_base = NULL;
+	iov[0].iov_len = 1;
+	JENT_UT_EQ(jent_read_entropy_iov(ec, iov, 1),
+		   (ssize_t)JENT_ERR_EINVAL, "and a NULL buffer");
+	JENT_UT_EQ(jent_read_entropy_iov(ec, iov, 0), 0,
+		   "no buffers deliver nothing");
+
+	memset(a, 0, sizeof(a));
+	memset(c, 0, sizeof(c));
+	iov[0].iov_base = a;
+	iov[0].iov_len = sizeof(a);
+	iov[1].iov_base = NULL;
+	iov[1].iov_len = 0;
+	iov[2].iov_base = b;
+	iov[2].iov_len = sizeof(b);
+	iov[3].iov_base = c;
+	iov[3].iov_len = sizeof(c);
+
+	invocations = ec->read_invocations;
+	bytes = ec->bytes_output;
+	JENT_UT_EQ(jent_read_entropy_iov(ec, iov, 4),
+		   (ssize_t)(sizeof(a) + sizeof(b) + sizeof(c)),
+		   "every buffer is filled");
+	JENT_UT_EQ(ec->read_invocations, invocations + 1,
+		   "in a single read");
+	JENT_UT_EQ(ec->bytes_output, bytes + sizeof(a) + sizeof(b) + sizeof(c),
+		   "which accounts all of them");
+	JENT_UT_TRUE(memcmp(a, c, sizeof(a)), "from blocks of their own");
+
+	jent_entropy_collector_free(ec);
+}
+
+struct stream_state {
+	size_t bytes;
+	unsigned int calls;
+	unsigned int stop_after;
+	size_t max_len;
+};
+
+static int stream_sink(void *ctx, const char *data, size_t len)
+{
+	struct stream_state *state = ctx;
+
+	(void)data;
+	state->bytes += len;
+	if (len > state->max_len)
+		state->max_len = len;
+
+	return ++state->calls == state->stop_after;
+}
+
+/*
+ * jent_read_entropy_stream() hands the request to the sink in blocks and ends
+ * it early when the sink asks to.
+ */
+static void test_read_entropy_stream(void)
+{
+	struct rand_data *ec;
+	struct stream_state state;
+
+	jent_ut_group("jent_read_entropy_stream");
+
+	memset(&state, 0, sizeof(state));
+	JENT_UT_EQ(jent_read_entropy_stream(NULL, 32, stream_sink, &state),
+		   (ssize_t)JENT_ERR_EINVAL, "a NULL collector is refused");
+
+	ec = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_8kB);
+	if (!ec) {
+		JENT_UT_SKIP("jent_read_entropy_stream",
+			     "no collector could be allocated");
+		return;
+	}
+	JENT_UT_EQ(jent_read_entropy_stream(ec, 32, NULL, NULL),
+		   (ssize_t)JENT_ERR_EINVAL, "as is a NULL sink");
+
+	JENT_UT_EQ(jent_read_entropy_stream(ec, 200, stream_sink, &state),
+		   (ssize_t)200, "the whole request is streamed");
+	JENT_UT_EQ(state.bytes, 200, "to the sink");
+	JENT_UT_EQ(state.calls, 7U, "in blocks");
+	JENT_UT_EQ(state.max_len, 32, "of at most 32 bytes");
+
+	memset(&state, 0, sizeof(state));
+	state.stop_after = 2;
+	JENT_UT_EQ(jent_read_entropy_stream(ec, 200, stream_sink, &state),
+		   (ssize_t)64, "a sink ends the request");
+	JENT_UT_EQ(state.calls, 2U, "after the block it stopped at");
+
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * A deferred collector refuses to deliver until its startup completed, round
+ * by round through jent_entropy_collector_start() or at once through
+ * jent_read_entropy_safe(), and then looks like one from
+ * jent_entropy_collector_alloc().
+ */
+static void test_deferred_startup(void)
+{
+	static const unsigned int flags[] = { JENT_MAX_MEMSIZE_8kB,
+					      JENT_MAX_MEMSIZE_8kB |
+					      JENT_FORCE_FIPS };
+	struct rand_data *ec;
+	char buf[48];
+	unsigned int i, rounds;
+	int ret;
+
+	jent_ut_group("the deferred startup");
+
+	JENT_UT_EQ(jent_entropy_collector_start(NULL), JENT_ERR_EINVAL,
+		   "a NULL handle is refused");
+	ec = NULL;
+	JENT_UT_EQ(jent_entropy_collector_start(&ec), JENT_ERR_EINVAL,
+		   "as is a NULL collector");
+
+	for (i = 0; i < JENT_ARRAY_SIZE(flags); i++) {
+		ec = jent_entropy_collector_alloc_deferred(0, flags[i]);
+		if (!ec) {
+			JENT_UT_SKIP("the deferred startup",
+				     "no collector could be allocated");
+			return;
+		}
+		JENT_UT_TRUE(ec->starting, "a deferred collector is starting");
+		JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+			   (ssize_t)JENT_ERR_STARTING,
+			   "and refuses to deliver");
+
+		rounds = 0;
+		do {
+			ret = jent_entropy_collector_start(&ec);
+			rounds++;
+		} while (ret == JENT_ERR_STARTING && rounds < 1000);
+		JENT_UT_EQ(ret, 0, "its startup completes round by round");
+		printf("  note: %u startup round(s)\n", rounds);
+		JENT_UT_TRUE(!ec->starting &&
+			     ec->startup_state == jent_startup_completed,
+			     "through all of its stages");
+		JENT_UT_TRUE(ec->uuid[0] != '\0',
+			     "and with an identifier assigned");
+		JENT_UT_EQ(jent_entropy_collector_start(&ec), 0,
+			   "a started collector needs no further round");
+		JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+			   (ssize_t)sizeof(buf), "and delivers");
+		jent_entropy_collector_free(ec);
+
+		ec = jent_entropy_collector_alloc_deferred(0, flags[i]);
+		if (!ec)
+			continue;
+		JENT_UT_EQ(jent_read_entropy_safe(&ec, buf, sizeof(buf)),
+			   (ssize_t)sizeof(buf),
+			   "jent_read_entropy_safe completes the startup");
+		JENT_UT_TRUE(!ec->starting, "before it reads");
+		jent_entropy_collector_free(ec);
+	}
+
+	JENT_UT_TRUE(!jent_entropy_collector_alloc_deferred(
+			     0, JENT_DISABLE_MEMORY_ACCESS | JENT_FORCE_FIPS),
+		     "the flag conflicts of jent_entropy_collector_alloc apply");
+}
+
+#ifdef JENT_ARCH_MEM_FORK
+/*
+ * A collector read in a fork() child first gets a state and an identifier of
+ * its own, once, and keeps delivering. The child handler is invoked directly:
+ * the generation it moves is what the collector compares against.
+ */
+static void test_fork_rekey(void)
+{
+	struct rand_data *ec;
+	char uuid[JENT_UUID_STRLEN];
+	char buf[32];
+
+	jent_ut_group("the rekeying of a fork() child");
+
+	ec = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_8kB);
+	if (!ec) {
+		JENT_UT_SKIP("the fork rekeying",
+			     "no collector could be allocated");
+		return;
+	}
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+		   (ssize_t)sizeof(buf), "a collector delivers");
+	JENT_UT_EQ(ec->fork_rekeys, 0U, "without a rekeying");
+	memcpy(uuid, ec->uuid, sizeof(uuid));
+
+	jent_fork_child();
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+		   (ssize_t)sizeof(buf), "a copy in a child delivers");
+	JENT_UT_EQ(ec->fork_rekeys, 1U, "after one rekeying");
+	JENT_UT_EQ(ec->fork_generation, jent_fork_generation(),
+		   "which moves it to the generation of the child");
+	JENT_UT_TRUE(memcmp(uuid, ec->uuid, sizeof(uuid)),
+		     "with an identifier of its own");
+
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+		   (ssize_t)sizeof(buf), "the next read delivers");
+	JENT_UT_EQ(ec->fork_rekeys, 1U, "without a second rekeying");
+
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * Read the block jent_entropy_step() completed before the fork() in a child:
+ * the first read must find it dropped, the child collects and returns a block
+ * of its own. Written to fd as the return of that first read and the block.
+ */
+static void jent_ut_step_child(struct rand_data *ec, int fd)
+{
+	struct {
+		ssize_t first;
+		char block[32];
+	} res;
+	int ret;
+
+	res.first = jent_read_entropy_step(ec, res.block, sizeof(res.block));
+	while (!(ret = jent_entropy_step(ec, 64)))
+		;
+	if (ret != 1 ||
+	    jent_read_entropy_step(ec, res.block, sizeof(res.block)) !=
+	    (ssize_t)sizeof(res.block))
+		_exit(1);
+
+	_exit(write(fd, &res, sizeof(res)) == (ssize_t)sizeof(res) ? 0 : 1);
+}
+
+/*
+ * A block completed before a fork() is the same in every child. Two children
+ * forked after jent_entropy_step() returned 1 each drop it and generate
+ * output of their own.
+ */
+static void test_fork_step(void)
+{
+	struct {
+		ssize_t first;
+		char block[32];
+	} res[2];
+	struct rand_data *ec;
+	pid_t pid[2];
+	int fds[2], status, ret;
+	unsigned int i;
+
+	jent_ut_group("a block completed before fork()");
+
+	ec = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_8kB);
+	if (!ec) {
+		JENT_UT_SKIP("the fork of a completed block",
+			     "no collector could be allocated");
+		return;
+	}
+
+	/* Registers the fork handler before the fork() */
+	(void)jent_fork_generation();
+	while (!(ret = jent_entropy_step(ec, 64)))
+		;
+	JENT_UT_EQ(ret, 1, "a block completes");
+
+	if (pipe(fds)) {
+		JENT_UT_SKIP("the fork of a completed block", "no pipe");
+		jent_entropy_collector_free(ec);
+		return;
+	}
+
+	for (i = 0; i < 2; i++) {
+		fflush(stdout);
+		pid[i] = fork();
+		if (!pid[i])
+			jent_ut_step_child(ec, fds[1]);
+	}
+	close(fds[1]);
+
+	for (i = 0; i < 2; i++) {
+		JENT_UT_TRUE(pid[i] > 0 && waitpid(pid[i], &status, 0) == pid[i] &&
+			     WIFEXITED(status) && !WEXITSTATUS(status),
+			     "a child generates");
+		if (read(fds[0], &res[i], sizeof(res[i])) !=
+		    (ssize_t)sizeof(res[i]))
+			memset(&res[i], 0, sizeof(res[i]));
+	}
+	close(fds[0]);
+
+	JENT_UT_TRUE(!res[0].first && !res[1].first,
+		     "after dropping the block of the parent");
+	JENT_UT_TRUE(memcmp(res[0].block, res[1].block, sizeof(res[0].block)),
+		     "and the two children generate different output");
+
+	JENT_UT_EQ(jent_read_entropy_step(ec, res[0].block,
+					  sizeof(res[0].block)),
+		   (ssize_t)32, "the parent keeps its block");
+
+	JENT_UT_EQ(jent_entropy_step(ec, 16), 0, "a block is begun");
+	JENT_UT_TRUE(ec->block_samples > 1, "over some samples");
+	jent_fork_child();
+	JENT_UT_EQ(jent_entropy_step(ec, 1), 0, "and after a fork()");
+	JENT_UT_TRUE(ec->block_samples <= 1,
+		     "is dropped and collected anew");
+
+	jent_entropy_collector_free(ec);
+}
+#endif
+
+/*
+ * An XDRBG child draws its seeds from the collector - at allocation, after its
+ * reseed threshold and after a fork() - and generates in between without it.
+ * It follows the collector when a health failure recovery replaces it.
+ */
+static void test_drbg_child(void)
+{
+	struct rand_data *ec, *old;
+	struct jent_drbg_child *a, *b;
+	char buf_a[200], buf_b[200];
+	uint64_t bytes, old_reinit;
+
+	jent_ut_group("the XDRBG children");
+
+	ec = NULL;
+	JENT_UT_TRUE(!jent_drbg_child_alloc(NULL, 0) &&
+		     !jent_drbg_child_alloc(&ec, 0),
+		     "a NULL collector is refused");
+	JENT_UT_EQ(jent_drbg_child_generate(NULL, buf_a, 1),
+		   (ssize_t)JENT_ERR_EINVAL, "as is a NULL child");
+
+	ec = jent_entropy_collector_alloc(0, JENT_MAX_MEMSIZE_8kB);
+	if (!ec) {
+		JENT_UT_SKIP("the XDRBG children",
+			     "no collector could be allocated");
+		return;
+	}
+
+	bytes = ec->bytes_output;
+	a = jent_drbg_child_alloc(&ec, 64);
+	b = jent_drbg_child_alloc(&ec, 0);
+	JENT_UT_TRUE(a && b, "children are allocated");
+	if (!a || !b)
+		goto out;
+	JENT_UT_EQ(ec->bytes_output, bytes + 2 * JENT_DRBG_CHILD_SEED,
+		   "each seeded from the collector");
+	JENT_UT_EQ(b->reseed_bytes, JENT_DRBG_CHILD_RESEED_DEFAULT,
+		   "with the default threshold for 0");
+	JENT_UT_EQ(jent_drbg_child_generate(a, NULL, 1),
+		   (ssize_t)JENT_ERR_EINVAL, "a NULL buffer is refused");
+
+	bytes = ec->bytes_output;
+	JENT_UT_EQ(jent_drbg_child_generate(b, buf_b, sizeof(buf_b)),
+		   (ssize_t)sizeof(buf_b), "a child generates");
+	JENT_UT_EQ(ec->bytes_output, bytes, "without the collector");
+
+	JENT_UT_EQ(jent_drbg_child_generate(a, buf_a, sizeof(buf_a)),
+		   (ssize_t)sizeof(buf_a), "a child of a low threshold");
+	JENT_UT_EQ(ec->bytes_output, bytes + 3 * JENT_DRBG_CHILD_SEED,
+		   "reseeds every 64 bytes");
+	JENT_UT_TRUE(memcmp(buf_a, buf_b, sizeof(buf_a)),
+		     "children generate output of their own");
+
+#ifdef JENT_ARCH_MEM_FORK
+	bytes = ec->bytes_output;
+	jent_fork_child();
+	JENT_UT_EQ(jent_drbg_child_generate(b, buf_b, 16), (ssize_t)16,
+		   "a copy in a fork() child generates");
+	JENT_UT_EQ(ec->bytes_output, bytes + JENT_DRBG_CHILD_SEED,
+		   "after a reseed");
+	JENT_UT_EQ(b->fork_generation, jent_fork_generation(),
+		   "in the generation of the child");
+#endif
+
+	/* An intermittent failure the next reseed runs into */
+	old = ec;
+	old_reinit = ec->reinit_count;
+	ec->is_fips_enabled = 1;
+	ec->health_failure = JENT_RCT_FAILURE;
+	JENT_UT_EQ(jent_drbg_child_generate(a, buf_a, sizeof(buf_a)),
+		   (ssize_t)sizeof(buf_a),
+		   "a child reseeds past a health failure of the collector");
+	JENT_UT_TRUE(ec != old && ec->reinit_count == old_reinit + 1,
+		     "from the collector the recovery replaced it with");
+
+	/* Due a reseed */
+	b->output = b->reseed_bytes;
+	bytes = ec->bytes_output;
+	JENT_UT_EQ(jent_drbg_child_generate(b, buf_b, sizeof(buf_b)),
+		   (ssize_t)sizeof(buf_b), "its siblings reseed");
+	JENT_UT_EQ(ec->bytes_output, bytes + JENT_DRBG_CHILD_SEED,
+		   "from the replacement as well");
+
+out:
+	jent_drbg_child_free(a);
+	jent_drbg_child_free(b);
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * jent_autotune() benchmarks the host, so which configuration wins is not
+ * asserted. What is: the arguments it rejects, that the winner respects the
+ * starting point it was given, and that the profile allocates as it is.
+ */
+static void test_autotune(void)
+{
+	struct rand_data *ec;
+	unsigned int osr = JENT_MAX_OSR + 1, flags = 0;
+	uint64_t elapsed;
+	int ret, notime;
+
+	jent_ut_group("jent_autotune");
+
+	JENT_UT_EQ(jent_autotune(NULL, &flags), -1, "a NULL osr is rejected");
+	JENT_UT_EQ(jent_autotune(&osr, NULL), -1, "NULL flags are rejected");
+	JENT_UT_EQ(jent_autotune(&osr, &flags), -1,
+		   "an osr above JENT_MAX_OSR is rejected");
+
+	osr = JENT_MIN_OSR + 1;
+	flags = JENT_MAX_MEMSIZE_64kB;
+	ret = jent_autotune(&osr, &flags);
+	JENT_UT_EQ(ret, 0, "a configuration is found");
+	if (ret)
+		return;
+
+	printf("  note: osr %u.%02u, %u bytes, hash loop %u\n", osr,
+	       JENT_FLAGS_TO_OSR_FRACTION(flags) * 25, jent_memsize(flags),
+	       jent_hashloop_cnt(flags));
+	JENT_UT_TRUE(osr >= JENT_MIN_OSR + 1,
+		     "the search starts at the rate given");
+	JENT_UT_TRUE(jent_memsize(flags) <= jent_memsize(JENT_MAX_MEMSIZE_64kB),
+		     "the memory size stays within the cap");
+
+	ec = jent_entropy_collector_alloc(osr, flags);
+	JENT_UT_TRUE(ec != NULL, "the profile allocates a collector");
+	if (!ec)
+		return;
+
+	JENT_UT_EQ(JENT_OSR_QUARTERS(ec),
+		   osr * 4 + JENT_FLAGS_TO_OSR_FRACTION(flags),
+		   "with the oversampling rate of the profile");
+	JENT_UT_EQ(jent_memsize(ec->flags), jent_memsize(flags),
+		   "and its memory size");
+	jent_entropy_collector_free(ec);
+
+	/* The grid point whose memory size the caches determine */
+	ret = jent_autotune_point(JENT_MIN_OSR * 4, JENT_HASHLOOP_1, &osr,
+				  &flags, &elapsed, &notime);
+	JENT_UT_EQ(ret, 0, "the cache-sized grid point passes");
+	if (ret)
+		return;
+
+	JENT_UT_EQ(JENT_FLAGS_TO_MAX_MEMSIZE(flags), 0,
+		   "and is returned without a memory size");
+	ec = jent_entropy_collector_alloc(osr, flags);
+	JENT_UT_TRUE(ec != NULL, "the profile allocates a collector");
+	if (!ec)
+		return;
+
+	JENT_UT_EQ(ec->max_mem_set, 0, "which may still grow its memory");
+	jent_entropy_collector_free(ec);
+}
+
 int main(void)
 {
 	jent_ut_setup();
@@ -567,10 +1450,25 @@ int main(void)
 	test_status_truncation();
 	test_uuid_api();
 	test_secure_memory_supported();
+	test_bind_node();
+	test_collector_init();
+	test_shared_memory();
+	test_collector_pool();
+	test_read_entropy_timed();
+	test_entropy_step();
+	test_read_entropy_iov();
+	test_read_entropy_stream();
+	test_deferred_startup();
+#ifdef JENT_ARCH_MEM_FORK
+	test_fork_rekey();
+	test_fork_step();
+#endif
+	test_drbg_child();
 	test_init();
 	test_selftest();
 	test_selftest_failure_stops_output();
 	test_compliance_modes();
+	test_autotune();
 
 	return jent_ut_report("unit-base-api");
 }
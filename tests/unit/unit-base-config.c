@@ -174,6 +174,236 @@ static void test_osr(void)
 		   "a value above the minimum is kept");
 }
 
+/*
+ * A JENT_OSR_PLUS_* fraction stretches the collection loop and the cutoffs
+ * derived from the rate. The RCT with memory computes its cutoff at run time
+ * for a fraction, so that computation has to reproduce the tables at the
+ * integer rates the tables cover.
+ */
+
+static void test_osr_fraction(void)
+{
+	struct rand_data *ec;
+	unsigned int osr;
+	char what[64];
+
+	jent_ut_group("fractional oversampling rates");
+
+	for (osr = 1; osr <= JENT_MAX_OSR; osr++) {
+		snprintf(what, sizeof(what),
+			 "the RCT with memory cutoffs at osr %u", osr);
+		JENT_UT_EQ(jent_rct_mem_cutoff(osr * 4, 1, 4, 0),
+			   jent_rct_mem_cutoff_lookup[osr - 1], what);
+		JENT_UT_EQ(jent_rct_mem_cutoff(osr * 4, 1, 5, 1),
+			   jent_rct_mem_cutoff_permanent_lookup[osr - 1], what);
+		JENT_UT_EQ(jent_rct_mem_cutoff(osr * 4, 8, 4, 0),
+			   jent_rct_mem_cutoff_lookup_ntg1[osr - 1], what);
+		JENT_UT_EQ(jent_rct_mem_cutoff(osr * 4, 8, 5, 1),
+			   jent_rct_mem_cutoff_permanent_lookup_ntg1[osr - 1],
+			   what);
+	}
+
+	for (osr = JENT_MIN_OSR * 4; osr < JENT_MAX_OSR * 4; osr++) {
+		if (jent_rct_mem_cutoff(osr, 8, 4, 0) >
+		    jent_rct_mem_cutoff(osr + 1, 8, 4, 0))
+			break;
+	}
+	JENT_UT_EQ(osr, JENT_MAX_OSR * 4,
+		   "the NTG.1 cutoff grows with every quarter");
+
+	ec = jent_entropy_collector_alloc_internal(JENT_MIN_OSR,
+						   JENT_OSR_PLUS_1_4);
+	JENT_UT_TRUE(ec != NULL, "a collector with a fraction is allocated");
+	if (ec) {
+		JENT_UT_EQ(JENT_OSR_QUARTERS(ec), JENT_MIN_OSR * 4 + 1,
+			   "the fraction is kept");
+		JENT_UT_EQ(ec->rct_cutoff,
+			   (JENT_HEALTH_RCT_INTERMITTENT_CUTOFF(JENT_MIN_OSR * 4 + 1)
+			    + 3) / 4,
+			   "the RCT cutoff is that of the fractional rate");
+		JENT_UT_EQ(ec->apt_cutoff,
+			   jent_apt_cutoff_lookup[JENT_MIN_OSR - 1] +
+			   (jent_apt_cutoff_lookup[JENT_MIN_OSR] -
+			    jent_apt_cutoff_lookup[JENT_MIN_OSR - 1] + 3) / 4,
+			   "the APT cutoff is interpolated a quarter of the way");
+		JENT_UT_TRUE(ec->apt_cutoff < jent_apt_cutoff_lookup[JENT_MIN_OSR],
+			     "below the entry of the next higher rate");
+		JENT_UT_EQ(ec->rct_mem_cutoff,
+			   jent_rct_mem_cutoff(JENT_MIN_OSR * 4 + 1, 1, 4, 0),
+			   "the RCT with memory cutoff is computed");
+		jent_entropy_collector_free(ec);
+	}
+
+	ec = jent_entropy_collector_alloc_internal(JENT_MAX_OSR,
+						   JENT_OSR_PLUS_3_4);
+	JENT_UT_TRUE(ec != NULL, "a fraction at the maximum is accepted");
+	if (ec) {
+		JENT_UT_EQ(JENT_OSR_QUARTERS(ec), JENT_MAX_OSR * 4,
+			   "but ignored there");
+		jent_entropy_collector_free(ec);
+	}
+}
+
+/*
+ * Every JENT_MEMACCESS_* pattern walks the memory block of its collector. The
+ * strided patterns must visit every byte exactly once in as many accesses as
+ * the block has bytes - a step that shares a factor with the block size would
+ * leave parts of it cold. The chase has no such guarantee but must not get
+ * stuck on a few bytes either.
+ */
+
+static void test_memaccess_pattern(void)
+{
+	static const struct {
+		unsigned int flag;
+		int full_cycle;
+	} patterns[] = {
+		{ JENT_MEMACCESS_STRIDE,	1 },
+		{ JENT_MEMACCESS_RANDOM,	0 },
+		{ JENT_MEMACCESS_CHASE,		0 },
+		{ JENT_MEMACCESS_CACHE_STRIDE,	1 },
+		{ JENT_MEMACCESS_MULTISTREAM,	1 },
+	};
+	struct rand_data *ec;
+	unsigned int i, touched, once;
+	uint32_t j, memsize;
+	char what[64];
+
+	jent_ut_group("memory access patterns");
+
+	for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+		ec = jent_entropy_collector_alloc_internal(JENT_MIN_OSR,
+			patterns[i].flag | JENT_MAX_MEMSIZE_1kB);
+		snprintf(what, sizeof(what), "pattern %u is allocated",
+			 JENT_FLAGS_TO_MEMACCESS(patterns[i].flag));
+		JENT_UT_TRUE(ec != NULL, what);
+		if (!ec)
+			continue;
+
+		memsize = ec->memmask + 1;
+		memset(ec->mem, 0, memsize);
+		jent_memaccess_patterns[JENT_FLAGS_TO_MEMACCESS(ec->flags)].access(
+			ec, memsize, NULL);
+
+		touched = once = 0;
+		for (j = 0; j < memsize; j++) {
+			touched += !!ec->mem[j];
+			once += ec->mem[j] == 1;
+		}
+
+		snprintf(what, sizeof(what), "%s visits every byte once",
+			 jent_memaccess_name(ec));
+		if (patterns[i].full_cycle)
+			JENT_UT_EQ(once, memsize, what);
+
+		snprintf(what, sizeof(what), "%s spreads over the block",
+			 jent_memaccess_name(ec));
+		JENT_UT_TRUE(touched >= memsize / 4, what);
+
+		jent_entropy_collector_free(ec);
+	}
+
+	ec = jent_entropy_collector_alloc_internal(JENT_MIN_OSR,
+		JENT_MEMACCESS_CACHE_STRIDE | JENT_MAX_MEMSIZE_1kB);
+	if (ec) {
+		JENT_UT_TRUE(ec->memstride & 1, "the cache stride is odd");
+		JENT_UT_TRUE(ec->memstride <= ec->memmask,
+			     "the cache stride is within the block");
+		jent_entropy_collector_free(ec);
+	}
+
+	/*
+	 * With JENT_CACHE_ALL the block is as large as all caches, whose size
+	 * would wrap the stride to the remainder alone; the L1 cache is used.
+	 */
+	ec = jent_entropy_collector_alloc_internal(JENT_MIN_OSR,
+		JENT_MEMACCESS_CACHE_STRIDE | JENT_CACHE_ALL);
+	if (ec && jent_cache_size_roundup(0) &&
+	    jent_cache_size_roundup(0) <= ec->memmask) {
+		JENT_UT_TRUE(ec->memstride != JENT_MEMORY_BLOCKSIZE - 1,
+			     "the JENT_CACHE_ALL stride is more than the remainder");
+		JENT_UT_EQ(ec->memstride,
+			   jent_cache_size_roundup(0) + JENT_MEMORY_BLOCKSIZE - 1,
+			   "it steps by the L1 cache");
+	} else {
+		JENT_UT_SKIP("the JENT_CACHE_ALL stride", "no L1 cache size known");
+	}
+	if (ec)
+		jent_entropy_collector_free(ec);
+
+	ec = jent_entropy_collector_alloc_internal(JENT_MIN_OSR,
+		JENT_MEMACCESS_TO_FLAGS(JENT_FLAGS_TO_MEMACCESS(
+			JENT_MEMACCESS_MAX) + 1));
+	JENT_UT_TRUE(ec == NULL, "an unknown pattern is refused");
+	if (ec)
+		jent_entropy_collector_free(ec);
+}
+
+/*
+ * Every JENT_HASHKERNEL_* kernel has to leave a result that depends on what it
+ * computed: the result is inserted into the entropy pool so that the
+ * computation cannot be dropped as unused. No two kernels may leave the
+ * same result from the same start. And as the intermediary is zeroed for each
+ * sample, the collector state has to give consecutive samples other operands.
+ */
+
+static void test_hash_kernel(void)
+{
+	static const uint8_t zero[JENT_SHA3_256_SIZE_DIGEST];
+	uint8_t digest[JENT_ARRAY_SIZE(jent_hash_kernels)]
+		      [JENT_SHA3_256_SIZE_DIGEST];
+	uint8_t again[JENT_SHA3_256_SIZE_DIGEST];
+	struct rand_data *ec;
+	unsigned int i;
+	char what[64];
+
+	jent_ut_group("hash loop kernels");
+
+	ec = jent_entropy_collector_alloc_internal(JENT_MIN_OSR,
+						   JENT_MAX_MEMSIZE_1kB);
+	JENT_UT_TRUE(ec != NULL, "a collector is allocated");
+	if (!ec)
+		return;
+
+	for (i = 0; i < JENT_ARRAY_SIZE(jent_hash_kernels); i++) {
+		memset(digest[i], 0, sizeof(digest[i]));
+		jent_hash_kernels[i].loop(ec, digest[i], 2);
+
+		snprintf(what, sizeof(what), "%s leaves a result",
+			 jent_hash_kernels[i].name);
+		JENT_UT_TRUE(memcmp(digest[i], zero, sizeof(zero)), what);
+
+		memset(again, 0, sizeof(again));
+		jent_hash_kernels[i].loop(ec, again, 2);
+		snprintf(what, sizeof(what), "%s depends on its input only",
+			 jent_hash_kernels[i].name);
+		JENT_UT_TRUE(!memcmp(digest[i], again, sizeof(again)), what);
+
+		/* The next sample starts from a zeroed intermediary again */
+		jent_measure_jitter(ec, 0, NULL);
+		memset(again, 0, sizeof(again));
+		jent_hash_kernels[i].loop(ec, again, 2);
+		snprintf(what, sizeof(what),
+			 "%s takes other operands in the next sample",
+			 jent_hash_kernels[i].name);
+		JENT_UT_TRUE(memcmp(digest[i], again, sizeof(again)), what);
+	}
+
+	JENT_UT_TRUE(memcmp(digest[0], digest[1], sizeof(digest[0])) &&
+		     memcmp(digest[0], digest[2], sizeof(digest[0])) &&
+		     memcmp(digest[1], digest[2], sizeof(digest[0])),
+		     "the kernels leave distinct results");
+
+	jent_entropy_collector_free(ec);
+
+	ec = jent_entropy_collector_alloc_internal(JENT_MIN_OSR,
+		JENT_HASHKERNEL_TO_FLAGS(JENT_FLAGS_TO_HASHKERNEL(
+			JENT_HASHKERNEL_MAX) + 1));
+	JENT_UT_TRUE(ec == NULL, "an unknown kernel is refused");
+	if (ec)
+		jent_entropy_collector_free(ec);
+}
+
 static void test_version(void)
 {
 	jent_ut_group("jent_version");
@@ -187,6 +417,9 @@ int main(void)
 	test_memsize();
 	test_hashloop();
 	test_osr();
+	test_osr_fraction();
+	test_memaccess_pattern();
+	test_hash_kernel();
 	test_version();
 
 	return jent_ut_report("unit-base-config");
@@ -286,6 +286,7 @@ static void test_startup_states(void)
 		enum jent_startup_state state;
 		const char *name;
 	} states[] = {
+		{ jent_startup_sched,		"the scheduler sampling stage" },
 		{ jent_startup_memory,		"the memory sampling stage" },
 		{ jent_startup_sha3,		"the hash sampling stage" },
 		{ jent_startup_completed,	"the completed state" },
@@ -392,6 +393,145 @@ static void test_generation_matrix(void)
 	}
 }
 
+/*
+ * The latency controller lowers the loop counts one step per window while
+ * the blocks take longer than the target, never below its floor, raises them
+ * back while there is room and returns to the allocated counts at once on a
+ * failed read.
+ */
+static void test_latency_control(void)
+{
+	struct rand_data *ec;
+	char buf[32];
+	unsigned int i;
+
+	jent_ut_group("the latency controller");
+
+	JENT_UT_EQ(jent_set_latency_target(NULL, 1), -EINVAL,
+		   "a NULL collector is rejected");
+
+	ec = jent_entropy_collector_alloc(0, JENT_FORCE_FIPS);
+	if (ec) {
+		JENT_UT_EQ(jent_set_latency_target(ec, 1), -EOPNOTSUPP,
+			   "the compliance modes keep their counts");
+		jent_entropy_collector_free(ec);
+	}
+
+	ec = jent_entropy_collector_alloc(0, JENT_HASHLOOP_4);
+	JENT_UT_TRUE(ec != NULL, "a collector is allocated");
+	if (!ec)
+		return;
+
+	JENT_UT_EQ(jent_set_latency_target(ec, 1), 0, "a target is set");
+
+	/* Far above the target: every window takes one step down. */
+	for (i = 0; i < 16 * JENT_LATENCY_WINDOW; i++)
+		jent_latency_control(ec, 1000);
+	JENT_UT_EQ(ec->memaccessloops, JENT_LATENCY_MEM_ACC_LOOP_MIN,
+		   "the memory access loops stop at the floor");
+	JENT_UT_EQ(ec->hashloopcnt, 1u, "the hash loops stop at one");
+	JENT_UT_EQ(ec->latency_reductions, 4u, "each step is counted");
+
+	ec->latency_target = 1000000;
+	for (i = 0; i < 16 * JENT_LATENCY_WINDOW; i++)
+		jent_latency_control(ec, 1);
+	JENT_UT_EQ(ec->memaccessloops, ec->latency_mem_loops_max,
+		   "with room, the memory access loops come back");
+	JENT_UT_EQ(ec->hashloopcnt, 4u,
+		   "and the hash loops, but not beyond the allocation");
+	JENT_UT_EQ(ec->latency_restorations, 4u, "each step is counted");
+
+	/* A target no block can meet drives the counts down while reading. */
+	JENT_UT_EQ(jent_set_latency_target(ec, 1), 0, "a tight target is set");
+	for (i = 0; i < 8 * JENT_LATENCY_WINDOW; i++) {
+		if (jent_read_entropy(ec, buf, sizeof(buf)) != sizeof(buf))
+			break;
+	}
+	JENT_UT_TRUE(ec->latency_reductions > 4u,
+		     "reading under the target lowers the counts");
+
+	/* Any failed read returns to the allocated counts. */
+	ec->selftest_failed = 1;
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+		   (ssize_t)JENT_ERR_SELFTEST, "a read fails");
+	JENT_UT_EQ(ec->memaccessloops, ec->latency_mem_loops_max,
+		   "the memory access loops are restored");
+	JENT_UT_EQ(ec->hashloopcnt, 4u, "and the hash loops");
+
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * The scheduling noise source of JENT_SCHED_NOISE: a collector using it starts
+ * up and generates, and its own RCT and APT catch a round trip time that
+ * stopped varying even while the samples it is part of still vary.
+ */
+static void test_sched_noise(void)
+{
+	struct rand_data *ec;
+	char buf[32];
+	unsigned int i;
+
+	jent_ut_group("the scheduling noise source");
+
+	ec = jent_entropy_collector_alloc(0, JENT_SCHED_NOISE |
+					     JENT_FORCE_FIPS);
+	JENT_UT_TRUE(ec != NULL, "a collector with it starts up");
+	if (!ec)
+		return;
+
+	JENT_UT_EQ(ec->startup_state, jent_startup_completed,
+		   "through all three startup stages");
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)), (ssize_t)sizeof(buf),
+		   "it generates");
+	JENT_UT_TRUE(ec->sched_apt_observations > 0,
+		     "and health tests the round trips");
+
+	/* A constant round trip time is stuck. */
+	ec->health_failure = 0;
+	jent_health_init(ec, jent_health_init_type_common);
+	for (i = 0; i <= ec->sched_rct_cutoff; i++)
+		jent_sched_stuck(ec, 42);
+	JENT_UT_EQ(ec->health_failure, (unsigned int)JENT_SCHED_RCT_FAILURE,
+		   "a constant round trip time fails the scheduling RCT");
+
+	/*
+	 * So is one growing by the same amount every time, from the third
+	 * value on: the first two still differ from the history before them.
+	 */
+	ec->health_failure = 0;
+	jent_health_init(ec, jent_health_init_type_common);
+	for (i = 0; i < ec->sched_rct_cutoff + 2u; i++)
+		jent_sched_stuck(ec, 1000 + 5 * i);
+	JENT_UT_EQ(ec->health_failure, (unsigned int)JENT_SCHED_RCT_FAILURE,
+		   "an evenly growing round trip time fails it as well");
+
+	/* One recurring among otherwise different ones fails the APT. */
+	ec->health_failure = 0;
+	jent_health_init(ec, jent_health_init_type_common);
+	ec->sched_apt_cutoff = 16;
+	for (i = 0; i < 2 * ec->sched_apt_cutoff; i++)
+		jent_sched_stuck(ec, (i & 1) ? 100 + i : 42);
+	JENT_UT_EQ(ec->health_failure, (unsigned int)JENT_SCHED_APT_FAILURE,
+		   "a recurring round trip time fails the scheduling APT alone");
+
+	/*
+	 * The cutoffs are those of the rate the sample claims, not the NTG.1
+	 * margin the startup of the other sources runs with.
+	 */
+	jent_health_init(ec, jent_health_init_type_ntg1);
+	JENT_UT_TRUE(ec->sched_apt_cutoff > ec->apt_cutoff,
+		     "the scheduling APT keeps its cutoff in an NTG.1 startup");
+	JENT_UT_TRUE(ec->sched_rct_cutoff > ec->rct_cutoff,
+		     "and so does its RCT");
+	jent_health_init(ec, jent_health_init_type_common);
+	JENT_UT_EQ(ec->sched_apt_cutoff, ec->apt_cutoff,
+		   "which is that of the common operation");
+	JENT_UT_EQ(ec->sched_rct_cutoff, ec->rct_cutoff, "for both tests");
+
+	jent_entropy_collector_free(ec);
+}
+
 int main(void)
 {
 	jent_ut_setup();
@@ -400,6 +540,8 @@ int main(void)
 	test_memaccess_variants();
 	test_startup_states();
 	test_generation_matrix();
+	test_latency_control();
+	test_sched_noise();
 	test_internal_timer();
 
 	return jent_ut_report("unit-base-gen");
@@ -51,8 +51,23 @@
 #include "jitterentropy-gcd.c"
 #include "jitterentropy-health.c"
 #include "jitterentropy-noise.c"
+/*
+ * The OSR ladder test below runs the concurrent recovery search whatever the
+ * machine has: the CPU count the ladder and its worker threads see is the one
+ * ut_ncpu() reports, and ut_get_nstime() stops the clock of the worker threads
+ * to make their power-up tests fail. Only a build with worker threads has any.
+ */
+#if defined(JENT_CONF_ENABLE_INTERNAL_TIMER) && defined(JENT_PTHREAD)
+#define UT_LADDER_WORKERS
+static long ut_ncpu(void);
+static void ut_get_nstime(uint64_t *out);
+#define jent_ncpu ut_ncpu
+#define jent_get_nstime ut_get_nstime
+#endif
 #include "jitterentropy-timer.c"
+#undef jent_get_nstime
 #include "jitterentropy-base.c"
+#undef jent_ncpu
 #include "jitterentropy-uuid.c"
 #include "jitterentropy-status.c"
 
@@ -83,6 +98,12 @@ static const struct {
 	  "Lag permanent",	1 },
 	{ JENT_RCT_MEM_FAILURE_PERMANENT, JENT_ERR_RCT_MEM_PERMANENT,
 	  "RCT-mem permanent",	1 },
+	{ JENT_SCHED_RCT_FAILURE,	JENT_ERR_SCHED_RCT,	"sched RCT",	0 },
+	{ JENT_SCHED_APT_FAILURE,	JENT_ERR_SCHED_APT,	"sched APT",	0 },
+	{ JENT_SCHED_RCT_FAILURE_PERMANENT, JENT_ERR_SCHED_RCT_PERMANENT,
+	  "sched RCT permanent", 1 },
+	{ JENT_SCHED_APT_FAILURE_PERMANENT, JENT_ERR_SCHED_APT_PERMANENT,
+	  "sched APT permanent", 1 },
 };
 
 /* Every health failure bit maps to the JENT_ERR_* code jitterentropy.h names. */
@@ -458,7 +479,7 @@ static void test_status_both_arms(void)
 	unsigned int all_flags =
 		JENT_DISABLE_MEMORY_ACCESS | JENT_FORCE_INTERNAL_TIMER |
 		JENT_DISABLE_INTERNAL_TIMER | JENT_FORCE_FIPS | JENT_NTG1 |
-		JENT_CACHE_ALL | JENT_FORCE_SECURE_MEM;
+		JENT_CACHE_ALL | JENT_FORCE_SECURE_MEM | JENT_ADAPTIVE_OSR;
 	unsigned int saved_flags;
 	size_t set_true, clear_true;
 
@@ -503,6 +524,215 @@ static void test_status_both_arms(void)
 	jent_entropy_collector_free(ec);
 }
 
+#ifdef UT_LADDER_WORKERS
+static long ut_ncpu_override;
+static int ut_stop_worker_clocks;
+static pthread_t ut_main_thread;
+
+static long ut_ncpu(void)
+{
+	return ut_ncpu_override ? ut_ncpu_override : jent_ncpu();
+}
+
+static void ut_get_nstime(uint64_t *out)
+{
+	if (ut_stop_worker_clocks &&
+	    !pthread_equal(pthread_self(), ut_main_thread)) {
+		*out = 0x5a5a5a5a5a5a5a5aULL;
+		return;
+	}
+	jent_get_nstime(out);
+}
+#endif /* UT_LADDER_WORKERS */
+
+/*
+ * A rung tested on a worker thread whose hardware timer fails must not take
+ * the fallback to the internal timer: that would force the internal timer on
+ * the whole process for a rung the sequential search never reaches once a
+ * lower one passed. Nor may its failing power-up test unmark the self tests
+ * the process has run: the next collector allocation would run the power-up
+ * test again, and could fail it.
+ */
+static void test_recovery_ladder_keeps_timer(void)
+{
+#ifdef UT_LADDER_WORKERS
+	unsigned int osr = JENT_MIN_OSR, candidates, width;
+	int ret;
+
+	jent_ut_group("a failing parallel rung keeps the hardware timer");
+
+	ut_main_thread = pthread_self();
+	ut_ncpu_override = 2 * JENT_OSR_LADDER_WIDTH;
+	ut_stop_worker_clocks = 1;
+	ret = jent_osr_ladder_search(&osr, 0, &candidates, &width);
+	ut_stop_worker_clocks = 0;
+	ut_ncpu_override = 0;
+
+	if (width < 2) {
+		JENT_UT_SKIP("a failing parallel rung",
+			     "no worker thread could be started");
+		return;
+	}
+	if (ret || osr != JENT_MIN_OSR) {
+		JENT_UT_SKIP("a failing parallel rung",
+			     "the lowest rung failed on the calling thread");
+		return;
+	}
+	JENT_UT_EQ(jent_notime_forced(), 0,
+		   "a parallel rung whose timer fails does not force the "
+		   "internal timer");
+	JENT_UT_EQ(jent_atomic_load_int(&jent_selftest_run), 1,
+		   "nor unmark the self tests");
+#endif
+}
+
+/*
+ * The OSR ladder search settles on the lowest rung that passes the power-up
+ * test however many rungs it tests at once, and the recovery records what it
+ * chose for jent_status().
+ */
+static void test_recovery_ladder(void)
+{
+	struct rand_data *ec;
+	unsigned int osr = JENT_MIN_OSR, candidates, width;
+	char buf[8192];
+	char expect[64];
+	ssize_t ret;
+
+	jent_ut_group("the recovery searches the OSR ladder and records its choice");
+
+	if (jent_osr_ladder_search(&osr, 0, &candidates, &width)) {
+		JENT_UT_SKIP("ladder search",
+			     "no OSR passes the power-up test on this machine");
+		return;
+	}
+
+	/* The lowest rung can fail its power-up test on a noisy machine. */
+	if (osr != JENT_MIN_OSR) {
+		JENT_UT_SKIP("the lowest passing rung is chosen",
+			     "the noise source did not converge on this machine");
+	} else {
+		JENT_UT_EQ(osr, (unsigned int)JENT_MIN_OSR,
+			   "the lowest passing rung is chosen");
+		JENT_UT_TRUE(candidates >= 1 && candidates <= width,
+			     "in a single round");
+	}
+	JENT_UT_TRUE(width >= 1 && width <= JENT_OSR_LADDER_WIDTH,
+		     "with at most the configured number of concurrent tests");
+
+	osr = JENT_MAX_OSR + 1;
+	JENT_UT_NE(jent_osr_ladder_search(&osr, 0, &candidates, &width), 0,
+		   "there is nothing to find above the maximum");
+	JENT_UT_EQ(candidates, 0u, "and nothing is tested");
+
+	ec = jent_entropy_collector_alloc(0, JENT_FORCE_FIPS);
+	if (!ec) {
+		JENT_UT_SKIP("recovery record", "no collector");
+		return;
+	}
+
+	JENT_UT_EQ(ec->recovery_candidates, 0u,
+		   "a collector that never recovered has no record");
+
+	ec->health_failure = JENT_APT_FAILURE;
+	ret = jent_read_entropy_safe(&ec, buf, 32);
+	if (ret < 0 || ec->reinit_count != 1) {
+		JENT_UT_SKIP("recovery record",
+			     "the noise source did not converge on this machine");
+		jent_entropy_collector_free(ec);
+		return;
+	}
+
+	JENT_UT_EQ(ec->recovery_osr, ec->osr, "the chosen OSR is recorded");
+	JENT_UT_EQ(ec->recovery_flags, ec->flags, "as are the chosen flags");
+	JENT_UT_TRUE(ec->recovery_candidates >= 1,
+		     "and the number of candidates tested");
+
+	JENT_UT_EQ(jent_status(ec, buf, sizeof(buf)), 0, "the status renders");
+	snprintf(expect, sizeof(expect), "\"candidatesTested\": %u",
+		 ec->recovery_candidates);
+	JENT_UT_TRUE(strstr(buf, "\"recovery\"") != NULL &&
+		     strstr(buf, expect) != NULL,
+		     "and reports the recovery");
+
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * JENT_ADAPTIVE_OSR takes the way back down after a clean window, one step at a
+ * time and never below the configuration the collector was allocated with.
+ * Without the flag, the raised configuration stays.
+ */
+static void test_adaptive_osr(void)
+{
+	static const unsigned int modes[] = { 0, JENT_ADAPTIVE_OSR };
+	size_t i;
+
+	jent_ut_group("JENT_ADAPTIVE_OSR steps back down after a clean window");
+
+	for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		struct rand_data *ec = jent_entropy_collector_alloc(
+			0, JENT_FORCE_FIPS | modes[i]);
+		char buf[32], uuid[JENT_UUID_STRLEN];
+		unsigned int floor, raised;
+		ssize_t ret;
+
+		if (!ec) {
+			JENT_UT_SKIP("adaptive OSR", "no collector");
+			continue;
+		}
+
+		floor = ec->osr;
+		JENT_UT_EQ(ec->osr_floor, floor,
+			   "the allocated OSR is the floor");
+		memcpy(uuid, ec->uuid, sizeof(uuid));
+
+		ec->health_failure = JENT_APT_FAILURE;
+		ret = jent_read_entropy_safe(&ec, buf, sizeof(buf));
+		if (ret < 0 || ec->osr <= floor) {
+			JENT_UT_SKIP("adaptive OSR",
+				     "the noise source did not converge on this machine");
+			jent_entropy_collector_free(ec);
+			continue;
+		}
+		raised = ec->osr;
+		JENT_UT_EQ(ec->osr_floor, floor,
+			   "the floor survives the recovery");
+
+		/* Pretend the window passed without a failure. */
+		ec->adaptive_clean_blocks = ec->adaptive_window;
+		ret = jent_read_entropy_safe(&ec, buf, sizeof(buf));
+		JENT_UT_EQ(ret, (ssize_t)sizeof(buf), "the output is delivered");
+
+		if (!modes[i]) {
+			JENT_UT_EQ(ec->osr, raised,
+				   "without the flag the OSR stays raised");
+			JENT_UT_EQ(ec->adaptive_step_downs, 0u,
+				   "and no step down is counted");
+		} else if (ec->osr == raised) {
+			JENT_UT_SKIP("the OSR steps down",
+				     "the lower OSR did not pass the power-up test");
+		} else {
+			JENT_UT_EQ(ec->osr, raised - 1,
+				   "with the flag the OSR steps down by one");
+			JENT_UT_EQ(ec->adaptive_step_downs, 1u,
+				   "the step down is counted");
+			JENT_UT_MEM_EQ(ec->uuid, uuid, sizeof(uuid),
+				       "the instance keeps its identity");
+			JENT_UT_EQ(ec->health_failure, 0u,
+				   "and starts with clean health tests");
+
+			/* At the floor, a clean window changes nothing. */
+			ec->adaptive_clean_blocks = ec->adaptive_window;
+			ret = jent_read_entropy_safe(&ec, buf, sizeof(buf));
+			JENT_UT_EQ(ec->osr, floor,
+				   "the OSR never goes below the floor");
+		}
+
+		jent_entropy_collector_free(ec);
+	}
+}
+
 /*
  * Recovery when the caller fixed the memory size. The reallocation normally
  * steps the memory size up along with the oversampling rate, but not over a
@@ -572,6 +802,9 @@ int main(void)
 	test_no_report_without_fips();
 	test_safe_recovery();
 	test_recovery_gives_up();
+	test_recovery_ladder();
+	test_recovery_ladder_keeps_timer();
+	test_adaptive_osr();
 	test_recovery_keeps_caller_memsize();
 	test_state_duplication();
 	test_status_both_arms();
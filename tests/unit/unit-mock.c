@@ -60,6 +60,7 @@
 #include "jitterentropy-base.c"
 #include "jitterentropy-uuid.c"
 #include "jitterentropy-status.c"
+#include "jitterentropy-autotune.c"
 
 #include "jitterentropy-arch-cache.c"
 #include "jitterentropy-arch-fips.c"
@@ -100,6 +101,8 @@ struct fi_replay {
 	 * caller can be made to fail its health tests and then recover.
 	 */
 	size_t bad_until;
+	/* Multiplier of the steps of FI_SHAPE_LINEAR */
+	uint64_t scale;
 
 	/*
 	 * Shapes that need every reading controlled, not just a recording
@@ -109,6 +112,7 @@ struct fi_replay {
 		FI_SHAPE_NONE = 0,
 		FI_SHAPE_DESCEND,	/* every reading below the last */
 		FI_SHAPE_MOSTLY_STUCK,	/* long constant runs, briefly broken */
+		FI_SHAPE_LINEAR,	/* every delta one above the last */
 	} shape;
 };
 
@@ -149,6 +153,16 @@ static void fi_replay_cb(void *arg, uint64_t *out)
 			r->tail += 1 + (r->step % 251);
 		*out = r->tail;
 		return;
+	case FI_SHAPE_LINEAR:
+		/*
+		 * Deltas that never repeat, but whose second derivative is
+		 * constant: every measurement is stuck on its third one. The
+		 * step is scaled by the timer GCD the collector divides by.
+		 */
+		r->step++;
+		r->tail += (uint64_t)r->step * r->scale;
+		*out = r->tail;
+		return;
 	case FI_SHAPE_NONE:
 	default:
 		break;
@@ -184,6 +198,7 @@ static void fi_replay_init(struct fi_replay *r, const uint64_t *stamps,
 	r->step = 7;
 	r->hold = 0;
 	r->bad_until = 0;
+	r->scale = 1;
 	r->shape = FI_SHAPE_NONE;
 }
 
@@ -609,6 +624,96 @@ static void test_generation_on_mocked_clock(void)
 	}
 }
 
+/*
+ * A deadline of jent_read_entropy_timed() that passes on stuck samples only:
+ * the block has no sample counted yet, and must still not be taken for a
+ * complete one. A budget of 0 and a clock that stops right after the read
+ * began is that case.
+ */
+static void test_timed_read_on_stuck_samples(void)
+{
+	struct fi_replay r;
+	struct rand_data *ec;
+	char buf[32];
+
+	jent_ut_group("a timed read interrupted on stuck samples");
+
+	if (jent_entropy_init()) {
+		JENT_UT_SKIP("a timed read", "the library does not initialize");
+		return;
+	}
+
+	fi_replay_init(&r, NULL, 0);
+	jent_set_mock_timer(fi_replay_cb, &r);
+	ec = jent_entropy_collector_alloc(0, JENT_DISABLE_INTERNAL_TIMER);
+	if (!ec) {
+		jent_set_mock_timer(NULL, NULL);
+		JENT_UT_SKIP("a timed read",
+			     "the constructed clock does not pass the startup");
+		return;
+	}
+
+	/*
+	 * The clock stops where it is: the deadline is the current reading,
+	 * which the first sample - stuck - already reaches.
+	 */
+	r.hold = 1;
+	JENT_UT_EQ(jent_read_entropy_timed(ec, buf, sizeof(buf), 0), 0,
+		   "no block is returned");
+	JENT_UT_EQ(ec->block_samples, 0, "the block has no sample counted");
+	JENT_UT_TRUE(ec->block_interrupted, "and is kept as interrupted");
+
+	r.hold = 0;
+	JENT_UT_EQ(jent_read_entropy(ec, buf, sizeof(buf)),
+		   (ssize_t)sizeof(buf), "the next read completes it");
+	jent_set_mock_timer(NULL, NULL);
+
+	jent_entropy_collector_free(ec);
+}
+
+/*
+ * The most common value estimate of jent_autotune() on deltas that are all
+ * different and all stuck: the stuck test rejects every one of them, so they
+ * must not pass as the uniform distribution their values alone suggest.
+ */
+static void test_autotune_mcv_on_stuck_deltas(void)
+{
+	struct fi_replay r;
+	struct rand_data *ec;
+
+	jent_ut_group("the autotune estimate on stuck deltas");
+
+	ec = jent_entropy_collector_alloc(0, JENT_DISABLE_INTERNAL_TIMER);
+	if (!ec) {
+		JENT_UT_SKIP("the autotune estimate",
+			     "no collector on the clock of this host");
+		return;
+	}
+	if (ec->is_fips_enabled) {
+		/* The RCT would reject the deltas before the estimate does */
+		JENT_UT_SKIP("the autotune estimate", "the host is in FIPS mode");
+		jent_entropy_collector_free(ec);
+		return;
+	}
+
+	fi_replay_init(&r, NULL, 0);
+	r.tail = ec->prev_time;
+	r.step = 1000;
+	r.scale = ec->jent_common_timer_gcd;
+	r.shape = FI_SHAPE_LINEAR;
+	jent_set_mock_timer(fi_replay_cb, &r);
+	JENT_UT_EQ(jent_autotune_mcv(ec), 1,
+		   "stuck deltas count as the most common value");
+
+	/* The varying clock of the recordings passes */
+	fi_replay_init(&r, NULL, 0);
+	r.tail = ec->prev_time;
+	JENT_UT_EQ(jent_autotune_mcv(ec), 0, "varying deltas pass");
+	jent_set_mock_timer(NULL, NULL);
+
+	jent_entropy_collector_free(ec);
+}
+
 /*
  * The reallocation the collector performs when its own startup trips a health
  * test. Only reachable when the measurements taken during startup are bad, so
@@ -805,6 +910,8 @@ int main(void)
 	test_ntg1_failure_does_not_force_notime();
 	test_timestamp_replay();
 	test_generation_on_mocked_clock();
+	test_timed_read_on_stuck_samples();
+	test_autotune_mcv_on_stuck_deltas();
 	test_realloc_during_startup();
 	test_realloc_on_read_gives_up();
 
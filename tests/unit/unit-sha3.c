@@ -214,6 +214,61 @@ static void test_shake256(void)
 	}
 }
 
+struct drbg_out_state {
+	uint8_t data[32];
+	size_t len;
+	const struct jent_sha_ctx *drbg;
+	size_t absorbed;
+};
+
+static int drbg_out(void *ctx, const uint8_t *data, size_t len)
+{
+	struct drbg_out_state *state = ctx;
+
+	memcpy(state->data, data, len);
+	state->len = len;
+	if (state->drbg)
+		state->absorbed = state->drbg->msg_len;
+	return 7;
+}
+
+/*
+ * jent_drbg_generate_block_out() hands the consumer the block that
+ * jent_drbg_generate_block() copies, and leaves the state the same way. The
+ * successor state is absorbed before the consumer runs.
+ */
+static void test_drbg_out(void)
+{
+	HASH_CTX_ON_STACK(a);
+	HASH_CTX_ON_STACK(b);
+	struct drbg_out_state state;
+	uint8_t block[32];
+
+	jent_ut_group("XDRBG output to a consumer");
+
+	jent_shake256_init(&a);
+	jent_sha3_update(&a, (const uint8_t *)"seed", 4);
+	jent_shake256_init(&b);
+	jent_sha3_update(&b, (const uint8_t *)"seed", 4);
+
+	memset(&state, 0, sizeof(state));
+	jent_drbg_generate_block(&a, block, 20);
+	JENT_UT_EQ(jent_drbg_generate_block_out(&b, 20, drbg_out, &state), 7,
+		   "the consumer's return value is passed on");
+	JENT_UT_EQ(state.len, 20, "it receives the requested length");
+	JENT_UT_MEM_EQ(state.data, block, 20, "and the block that is copied");
+
+	jent_drbg_generate_block(&a, block, sizeof(block));
+	jent_drbg_generate_block_out(&b, sizeof(block), drbg_out, &state);
+	JENT_UT_MEM_EQ(state.data, block, sizeof(block),
+		       "the state advances the same way");
+
+	state.drbg = &b;
+	jent_drbg_generate_block_out(&b, sizeof(block), drbg_out, &state);
+	JENT_UT_EQ(state.absorbed, JENT_XDRBG_SIZE_STATE,
+		   "the consumer runs with the successor state absorbed");
+}
+
 /* The heap-allocating variant, including the failure path of a bogus size. */
 static void test_alloc(void)
 {
@@ -241,6 +296,7 @@ int main(void)
 	test_sha3_256_kat();
 	test_sha3_incremental();
 	test_shake256();
+	test_drbg_out();
 	test_alloc();
 
 	return jent_ut_report("unit-sha3");
@@ -22,9 +22,9 @@
 
 /*
  * That the state is gone once an allocation is released. Everything the
- * library keeps - the entropy pool, the SHAKE state carrying the collected
- * entropy, the previous time stamp and the health test counters - is secret
- * for as long as it exists, and the only guarantee that it does not outlive
+ * library keeps - the SHAKE state carrying the collected entropy, the previous
+ * time stamp and the health test counters - is secret for as long as it
+ * exists, and the only guarantee that it does not outlive
  * the collector in freed heap memory or in a page handed to the next
  * allocation is the wipe jent_zfree() performs before it lets go.
  *
@@ -290,13 +290,17 @@ static void test_zfree_wipes(void)
 }
 
 /*
- * The collector's state, which is what the wipe exists for. Three allocations
+ * The collector's state, which is what the wipe exists for. Two allocations
  * carry it and each is released by jent_entropy_collector_free():
  *
- *   - the entropy pool, the memory the noise source walks,
  *   - the SHAKE state, which holds the collected entropy itself, and
  *   - struct rand_data, with the previous time stamp, the health test
- *     counters and the pointers to the other two.
+ *     counters and the pointers to the other allocations.
+ *
+ * The third, the entropy pool the noise source walks, holds counters whose
+ * values never reach the SHAKE state. It is released through
+ * jent_free_nonsensitive() and skips the wipe, which is checked as well: a
+ * wipe there is the cost of a large collector's free coming back.
  *
  * One collector per allocation: the watch follows one address at a time, and
  * the free path releases all three in the same call.
@@ -305,7 +309,7 @@ static void test_collector_state_wiped(void)
 {
 	enum { ZE_POOL, ZE_HASH, ZE_STATE, ZE_PARTS };
 	static const char *names[ZE_PARTS] = {
-		"the entropy pool is wiped on free",
+		"the entropy pool is released without a wipe",
 		"the hash state is wiped on free",
 		"the collector state is wiped on free",
 	};
@@ -382,7 +386,15 @@ static void test_collector_state_wiped(void)
 				memcpy(copy, ptr, len);
 				jent_entropy_collector_free(ec);
 				ze_disarm();
-				ze_check_wiped(copy, len, names[part]);
+				if (part != ZE_POOL) {
+					ze_check_wiped(copy, len, names[part]);
+				} else if (!ze_releases) {
+					JENT_UT_SKIP(names[part],
+						     "its release was not seen");
+				} else {
+					JENT_UT_TRUE(ze_dirty != 0,
+						     names[part]);
+				}
 				jent_memset_secure(copy, len);
 				free(copy);
 			} else {